@@ -0,0 +1,175 @@
+#pragma once
+
+#include <intrusive/intrusive.h>
+#include <shared-from-this/shared.h>
+#include <shared-from-this/weak.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>  // std::align
+#include <new>
+#include <type_traits>
+#include <utility>
+
+class Arena;
+
+// Objects in an arena are only destroyed by their last owner, the memory goes away with the arena
+struct ArenaDelete {
+    template <typename T>
+    static void Destroy(T* object);
+};
+
+// Base of the objects of Arena::MakeIntrusive. Debug builds remember the arena of the object.
+// Such objects only live in an arena: plain `new` does not compile.
+template <typename Derived, typename Counter = SimpleCounter>
+class ArenaRefCounted : public RefCounted<Derived, Counter, ArenaDelete> {
+public:
+    static void* operator new(size_t) = delete;
+    static void* operator new[](size_t) = delete;
+
+    static void* operator new(size_t, void* place) noexcept {
+        return place;
+    }
+
+#ifndef NDEBUG
+private:
+    friend class Arena;
+    friend struct ArenaDelete;
+
+    Arena* home_ = nullptr;
+#endif
+};
+
+template <typename Derived, typename Counter>
+std::true_type IsArenaRefCountedImpl(const ArenaRefCounted<Derived, Counter>*);
+
+std::false_type IsArenaRefCountedImpl(...);
+
+template <typename T>
+inline constexpr bool kIsArenaRefCounted =
+    decltype(IsArenaRefCountedImpl(std::declval<T*>()))::value;
+
+// Bump allocator for short-lived objects that all die together (e.g. with a request).
+// Owners handed out by the arena must not outlive it; debug builds check it.
+class Arena {
+public:
+    explicit Arena(size_t chunk_size = 64 * 1024) : chunk_size_(chunk_size) {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+#ifndef NDEBUG
+        assert(live_blocks_ == 0 && "owner outlived its arena");
+#endif
+        while (chunks_) {
+            Chunk* next = chunks_->next;
+            ::operator delete(chunks_);
+            chunks_ = next;
+        }
+    }
+
+    void* Allocate(size_t size, size_t align) {
+        void* ptr = std::align(align, size, current_, space_);
+        if (!ptr) {
+            AddChunk(size + align);
+            ptr = std::align(align, size, current_, space_);
+        }
+        current_ = static_cast<char*>(ptr) + size;
+        space_ -= size;
+        return ptr;
+    }
+
+    template <typename T, typename... Args>
+    SharedPtr<T> MakeShared(Args&&... args) {
+        auto block = new (Allocate(sizeof(Block<T>), alignof(Block<T>)))
+            Block<T>(this, std::forward<Args>(args)...);
+        SharedPtr<T> ptr;
+        ptr.cb_ = block;
+        ptr.observed_pole_ = static_cast<T*>(block->GetObjectPtr());
+        if constexpr (std::is_convertible_v<T*, ESFTBase*>) {
+            ptr.observed_pole_->SetWeakPtr(ptr);
+        }
+        return ptr;
+    }
+
+    // `T` derives from ArenaRefCounted, so that its last owner does not `delete` arena memory
+    template <typename T, typename... Args>
+    IntrusivePtr<T> MakeIntrusive(Args&&... args) {
+        static_assert(kIsArenaRefCounted<T>, "objects of Arena::MakeIntrusive use ArenaRefCounted");
+        auto object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+#ifndef NDEBUG
+        object->home_ = this;
+        ++live_blocks_;
+#endif
+        return IntrusivePtr<T>::AdoptNew(object);
+    }
+
+#ifndef NDEBUG
+    // Objects of MakeShared and MakeIntrusive that are still owned, only counted in debug builds
+    size_t LiveBlocks() const {
+        return live_blocks_;
+    }
+#endif
+
+private:
+    friend struct ArenaDelete;
+
+    template <typename T>
+    struct Block : ControlBlockWithObject<T> {
+        template <typename... Args>
+        Block(Arena* arena, Args&&... args) : ControlBlockWithObject<T>(std::forward<Args>(args)...) {
+#ifndef NDEBUG
+            home = arena;
+            ++home->live_blocks_;
+#else
+            (void)arena;
+#endif
+        }
+
+        void DestroySelf() {
+#ifndef NDEBUG
+            --home->live_blocks_;
+#endif
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                this->~Block();
+            }
+        }
+
+#ifndef NDEBUG
+        Arena* home;
+#endif
+    };
+
+    struct Chunk {
+        Chunk* next;
+    };
+
+    void AddChunk(size_t min_size) {
+        size_t size = std::max(chunk_size_, min_size + sizeof(Chunk));
+        chunks_ = new (::operator new(size)) Chunk{chunks_};
+        current_ = chunks_ + 1;
+        space_ = size - sizeof(Chunk);
+    }
+
+    size_t chunk_size_;
+    Chunk* chunks_ = nullptr;
+    void* current_ = nullptr;
+    size_t space_ = 0;
+#ifndef NDEBUG
+    size_t live_blocks_ = 0;
+#endif
+};
+
+template <typename T>
+void ArenaDelete::Destroy(T* object) {
+#ifndef NDEBUG
+    assert(object->home_ && "object was not created by Arena::MakeIntrusive");
+    --object->home_->live_blocks_;
+#endif
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+        object->~T();
+    }
+}
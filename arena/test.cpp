@@ -0,0 +1,121 @@
+#include "arena.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Node {
+    static int alive;
+
+    Node(std::string name) : name(std::move(name)) {
+        ++alive;
+    }
+
+    ~Node() {
+        --alive;
+    }
+
+    std::string name;
+};
+
+int Node::alive = 0;
+
+struct RefCountedNode : SimpleRefCounted<RefCountedNode> {};
+
+struct IntrusiveNode : ArenaRefCounted<IntrusiveNode> {
+    IntrusiveNode(int value) : value(value) {
+    }
+
+    int value;
+};
+
+TEST_CASE("Arena SharedPtr") {
+    SECTION("Lifetime") {
+        Arena arena;
+        {
+            auto a = arena.MakeShared<Node>("first");
+            auto b = a;
+            REQUIRE(a->name == "first");
+            REQUIRE(b.UseCount() == 2);
+            REQUIRE(Node::alive == 1);
+        }
+        REQUIRE(Node::alive == 0);
+#ifndef NDEBUG
+        REQUIRE(arena.LiveBlocks() == 0);
+#endif
+    }
+
+    SECTION("Weak references") {
+        Arena arena;
+        WeakPtr<Node> wp;
+        {
+            auto sp = arena.MakeShared<Node>("node");
+            wp = sp;
+        }
+        REQUIRE(wp.Expired());
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Bump allocation") {
+        Arena arena;
+        { auto warm_up = arena.MakeShared<int>(0); }
+        EXPECT_ZERO_ALLOCATIONS(for (int i = 0; i < 100; ++i) {
+            auto sp = arena.MakeShared<int>(i);
+            REQUIRE(*sp == i);
+        });
+    }
+
+    SECTION("Large and aligned objects") {
+        struct alignas(64) Wide {
+            char data[100000];
+        };
+        Arena arena(1024);
+        auto small = arena.MakeShared<int>(1);
+        auto wide = arena.MakeShared<Wide>();
+        REQUIRE(reinterpret_cast<uintptr_t>(wide.Get()) % 64 == 0);
+        REQUIRE(*small == 1);
+    }
+
+    SECTION("Converts to base") {
+        Arena arena;
+        std::vector<SharedPtr<const Node>> nodes;
+        for (int i = 0; i < 1000; ++i) {
+            nodes.push_back(arena.MakeShared<Node>(std::to_string(i)));
+        }
+        REQUIRE(nodes[999]->name == "999");
+        nodes.clear();
+        REQUIRE(Node::alive == 0);
+    }
+}
+
+TEST_CASE("Arena IntrusivePtr") {
+    Arena arena;
+    auto a = arena.MakeIntrusive<IntrusiveNode>(42);
+    auto b = a;
+    REQUIRE(b->value == 42);
+    REQUIRE(a.UseCount() == 2);
+#ifndef NDEBUG
+    REQUIRE(arena.LiveBlocks() == 1);
+#endif
+    a.Reset();
+    b.Reset();
+#ifndef NDEBUG
+    REQUIRE(arena.LiveBlocks() == 0);
+#endif
+}
+
+// Arena::MakeIntrusive rejects types whose last owner would `delete` arena memory
+static_assert(kIsArenaRefCounted<IntrusiveNode>);
+static_assert(!kIsArenaRefCounted<RefCountedNode>);
+
+// ...and their objects cannot be allocated outside of an arena
+template <typename T, typename... Args>
+concept HeapConstructible = requires(Args... args) { new T(args...); };
+
+static_assert(!HeapConstructible<IntrusiveNode, int>);
+static_assert(HeapConstructible<RefCountedNode>);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <chrono>
+
+// Wall-clock time of `body` in milliseconds. Only for the test cases tagged [.][bench], which
+// are not run by default: `test_xxx [bench]`.
+template <typename Body>
+long long BenchMilliseconds(Body&& body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto time = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time).count();
+}
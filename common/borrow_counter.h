@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Debug-only count of references to an object that the owners do not track, such as borrows
+// (SharedRef, IntrusiveRef) or detached IntrusivePtr references, so that misuse can be asserted.
+// A copy of the object starts from zero.
+class BorrowCounter {
+public:
+    BorrowCounter() = default;
+
+    BorrowCounter(const BorrowCounter&) {
+    }
+
+    BorrowCounter& operator=(const BorrowCounter&) {
+        return *this;
+    }
+
+    void Add() {
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Remove() {
+        count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    size_t Count() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<size_t> count_ = 0;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// `dynamic_cast<To*>(ptr)` that remembers its result per dynamic type. Under the Itanium C++ ABI
+// (GCC, Clang) a polymorphic subobject starts with its vtable pointer, and the vtable determines
+// both the most derived type and the position of the subobject in it, hence the distance to the
+// `To` subobject (or the failure of the cast). A few recent (vtable, offset) pairs are kept per
+// (From, To) in one atomic word each, so a repeated cast is a load and a compare.
+template <typename To, typename From>
+To* CachedDynamicCast(From* ptr) {
+    static_assert(std::is_polymorphic_v<From>);
+#if defined(__GXX_ABI_VERSION) && UINTPTR_MAX == UINT64_MAX
+    // Entry layout: vtable address in the low 48 bits, offset (or kFailed) in the high 16 bits
+    static constexpr size_t kEntries = 8;
+    static constexpr int64_t kFailed = INT16_MIN;
+    static constexpr uint64_t kAddressMask = (uint64_t(1) << 48) - 1;
+    static std::atomic<uint64_t> cache[kEntries];
+
+    if (!ptr) {
+        return nullptr;
+    }
+    auto source = reinterpret_cast<const char*>(ptr);
+    auto vtable = *reinterpret_cast<const uint64_t*>(source);
+    auto& entry = cache[(vtable * 0x9E3779B97F4A7C15ull) >> 61];
+    uint64_t cached = entry.load(std::memory_order_relaxed);
+    if (cached != 0 && (cached & kAddressMask) == vtable) {
+        auto offset = static_cast<int16_t>(cached >> 48);
+        if (offset == kFailed) {
+            return nullptr;
+        }
+        return reinterpret_cast<To*>(const_cast<char*>(source) + offset);
+    }
+
+    To* result = dynamic_cast<To*>(ptr);
+    int64_t offset = result ? reinterpret_cast<const char*>(result) - source : kFailed;
+    // Casts that do not fit into an entry are simply not cached
+    bool fits = offset > kFailed && offset <= INT16_MAX;
+    if ((vtable & ~kAddressMask) == 0 && (fits || !result)) {
+        entry.store(vtable | (static_cast<uint64_t>(static_cast<uint16_t>(offset)) << 48),
+                    std::memory_order_relaxed);
+    }
+    return result;
+#else
+    return dynamic_cast<To*>(ptr);
+#endif
+}
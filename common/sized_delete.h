@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+// Frees through the sized (and aligned) global operator delete, so that the allocator does not
+// have to look the size up. The sizes must be exactly the ones the memory was allocated with.
+
+// `delete ptr` goes to the global operator delete: T declares no operator delete of its own,
+// neither an ordinary nor a destroying one
+template <typename T>
+concept GlobalDeletable = !requires(T* ptr) { T::operator delete(ptr); } &&
+                          !requires(T* ptr) { T::operator delete(ptr, sizeof(T)); } &&
+                          !requires(T* ptr) { T::operator delete(ptr, std::destroying_delete); };
+
+// Same for `delete[] ptr`
+template <typename T>
+concept GlobalArrayDeletable = !requires(T* ptr) { T::operator delete[](ptr); } &&
+                               !requires(T* ptr) { T::operator delete[](ptr, sizeof(T)); };
+
+// Memory for a T to be constructed with placement new and later freed by DeallocateSized<T>
+template <typename T>
+void* AllocateSized() {
+    if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        return ::operator new(sizeof(T), std::align_val_t(alignof(T)));
+    } else {
+        return ::operator new(sizeof(T));
+    }
+}
+
+// Memory of `new T` (or AllocateSized<T>) whose object is already destroyed
+template <typename T>
+void DeallocateSized(void* memory) {
+    if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        ::operator delete(memory, sizeof(T), std::align_val_t(alignof(T)));
+    } else {
+        ::operator delete(memory, sizeof(T));
+    }
+}
+
+// The object must be exactly a T; meant for destroying operator deletes that know the dynamic
+// type (see intrusive/readme.md)
+template <typename T>
+void DestroyAndDeallocate(T* ptr) {
+    ptr->~T();
+    DeallocateSized<T>(const_cast<std::remove_cv_t<T>*>(ptr));
+}
+
+// Same as `delete ptr`. Polymorphic types go through their virtual destructor, which knows the
+// size of the dynamic type; types with their own operator delete keep it.
+template <typename T>
+void DeleteSized(T* ptr) {
+    if constexpr (GlobalDeletable<T> && (!std::is_polymorphic_v<T> || std::is_final_v<T>)) {
+        DestroyAndDeallocate(ptr);
+    } else {
+        delete ptr;
+    }
+}
+
+// Same as `delete[] ptr` for an array of `count` elements from `new T[count]`. Only trivially
+// destructible types have no array cookie, so only they get the size; `count == 0` means unknown.
+template <typename T>
+void DeleteArraySized(T* ptr, size_t count) {
+    if constexpr (std::is_trivially_destructible_v<T> && GlobalArrayDeletable<T>) {
+        if (count != 0) {
+            if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                ::operator delete[](ptr, count * sizeof(T), std::align_val_t(alignof(T)));
+            } else {
+                ::operator delete[](ptr, count * sizeof(T));
+            }
+            return;
+        }
+    }
+    delete[] ptr;
+}
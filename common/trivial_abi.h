@@ -0,0 +1,14 @@
+#pragma once
+
+// Opt-in (-DSMART_POINTERS_TRIVIAL_ABI=ON in CMake): smart pointers are marked
+// [[clang::trivial_abi]], so a pointer passed by value travels in a register like a raw pointer
+// and the callee destroys it. Other compilers ignore the option.
+#if defined(SMART_POINTERS_TRIVIAL_ABI) && defined(__has_cpp_attribute)
+#if __has_cpp_attribute(clang::trivial_abi)
+#define TRIVIAL_ABI [[clang::trivial_abi]]
+#endif
+#endif
+
+#ifndef TRIVIAL_ABI
+#define TRIVIAL_ABI
+#endif
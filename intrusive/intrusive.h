@@ -1,6 +1,14 @@
 #pragma once
 
+#include <common/borrow_counter.h>
+#include <common/cached_cast.h>
+#include <common/sized_delete.h>
+#include <common/trivial_abi.h>
+#include <relocate/relocate.h>
+
+#include <cassert>
 #include <cstddef>  // for std::nullptr_t
+#include <cstdlib>  // for std::abort
 #include <utility>  // for std::exchange / std::swap
 
 class SimpleCounter {
@@ -19,6 +27,11 @@ public:
         return count_;
     }
 
+    // First reference to an object nobody else sees yet
+    void Start() {
+        count_ = 1;
+    }
+
     SimpleCounter& operator=(const SimpleCounter& other) {
         size_t step_size = other.RefCount();
         step_size = count_;
@@ -30,27 +43,38 @@ private:
     size_t count_ = 0;
 };
 
+// `delete` with the size of the object. A hierarchy without a virtual destructor can declare a
+// destroying operator delete in its base instead, it is called here.
 struct DefaultDelete {
     template <typename T>
     static void Destroy(T* object) {
-        delete object;
+        DeleteSized(object);
     }
 };
 
+template <typename T>
+class IntrusivePtr;
+
+template <typename T, typename... Args>
+IntrusivePtr<T> MakeIntrusive(Args&&... args);
+
 template <typename Derived, typename Counter, typename Deleter>
 class RefCounted {
 public:
     // Increase reference counter.
-    void IncRef() {
+    // Const, like the counter itself, so that `IntrusivePtr<const T>` works.
+    void IncRef() const {
         counter_.IncRef();
     }
 
     // Decrease reference counter.
     // Destroy object using Deleter when the last instance dies.
-    void DecRef() {
-        counter_.DecRef();
-        if (counter_.RefCount() == 0) {
-            Deleter::Destroy(static_cast<Derived*>(this));
+    void DecRef() const {
+        if (counter_.DecRef() == 0) {
+#ifndef NDEBUG
+            assert(borrows_.Count() == 0 && "IntrusiveRef outlived its object");
+#endif
+            Deleter::Destroy(const_cast<Derived*>(static_cast<const Derived*>(this)));
         }
     }
 
@@ -59,18 +83,59 @@ public:
         return counter_.RefCount();
     }
 
+    // Side table for weak references, only for counters that support them (see WeakCounter).
+    auto AcquireWeakTable() {
+        return counter_.AcquireWeakTable();
+    }
+
+protected:
+    // For objects that outlive their last reference and get new owners later (ObjectPool):
+    // counters with weak references forget them
+    void RestartRefCount() const {
+        if constexpr (requires { counter_.Restart(); }) {
+            counter_.Restart();
+        }
+    }
+
 private:
-    Counter counter_;
+    template <typename T>
+    friend class IntrusiveRef;
+
+    template <typename T>
+    friend class IntrusivePtr;
+
+    // The first reference of a new object, without an atomic read-modify-write if the counter
+    // can do that
+    void StartRefCount() const {
+        if constexpr (requires { counter_.Start(); }) {
+            counter_.Start();
+        } else {
+            counter_.IncRef();
+        }
+    }
+
+    mutable Counter counter_;
+#ifndef NDEBUG
+    mutable BorrowCounter borrows_;
+    // References given away by IntrusivePtr::Detach and not adopted back yet
+    mutable BorrowCounter detached_;
+#endif
 };
 
 template <typename Derived, typename D = DefaultDelete>
 using SimpleRefCounted = RefCounted<Derived, SimpleCounter, D>;
 
 template <typename T>
-class IntrusivePtr {
+class IntrusiveWeakPtr;
+
+template <typename T>
+class TRIVIAL_ABI IntrusivePtr {
     template <typename Y>
     friend class IntrusivePtr;
 
+    template <typename Y>
+    friend class IntrusiveWeakPtr;
+
 public:
     // Constructors
     IntrusivePtr() : object_(nullptr) {
@@ -80,7 +145,9 @@ public:
     }
 
     IntrusivePtr(T* ptr) : object_(ptr) {
-        ptr->IncRef();
+        if (object_) {
+            object_->IncRef();
+        }
     }
 
     template <typename Y>
@@ -91,7 +158,7 @@ public:
     }
 
     template <typename Y>
-    IntrusivePtr(IntrusivePtr<Y>&& other) : object_(other.object_) {
+    IntrusivePtr(IntrusivePtr<Y>&& other) noexcept : object_(other.object_) {
         other.object_ = nullptr;
     }
 
@@ -101,7 +168,7 @@ public:
         }
     }
 
-    IntrusivePtr(IntrusivePtr&& other) : object_(other.object_) {
+    IntrusivePtr(IntrusivePtr&& other) noexcept : object_(other.object_) {
         other.object_ = nullptr;
     }
 
@@ -119,7 +186,7 @@ public:
         return *this;
     }
 
-    IntrusivePtr& operator=(IntrusivePtr&& other) {
+    IntrusivePtr& operator=(IntrusivePtr&& other) noexcept {
         if (&other != this) {
             if (object_) {
                 object_->DecRef();
@@ -138,7 +205,7 @@ public:
     }
 
     // Modifiers
-    void Reset() {
+    void Reset() noexcept {
         if (object_) {
             object_->DecRef();
             object_ = nullptr;
@@ -155,10 +222,50 @@ public:
         }
     }
 
-    void Swap(IntrusivePtr& other) {
+    void Swap(IntrusivePtr& other) noexcept {
         std::swap(object_, other.object_);
     }
 
+    // Gives the reference away without decrementing it, e.g. as the context of a C callback.
+    // It must come back through Adopt.
+    T* Detach() noexcept {
+#ifndef NDEBUG
+        if (object_) {
+            object_->detached_.Add();
+        }
+#endif
+        return std::exchange(object_, nullptr);
+    }
+
+    // Takes over a reference given away by Detach, without incrementing it
+    static IntrusivePtr Adopt(T* ptr) noexcept {
+#ifndef NDEBUG
+        if (ptr) {
+            assert(ptr->RefCount() > 0 && "adopting an object without references");
+            assert(ptr->detached_.Count() > 0 && "adopting a reference that was not detached");
+            ptr->detached_.Remove();
+        }
+#endif
+        IntrusivePtr result;
+        result.object_ = ptr;
+        return result;
+    }
+
+    // First reference to an object a factory has just constructed (MakeIntrusive, ObjectPool,
+    // Arena...): the count starts at one without an atomic read-modify-write if the counter can
+    // do that. A reference taken in the meantime would be overwritten, so release builds abort
+    // too.
+    static IntrusivePtr AdoptNew(T* ptr) noexcept {
+        assert(ptr->RefCount() == 0 && "adopting an object that is already referenced");
+        if (ptr->RefCount() != 0) {
+            std::abort();
+        }
+        ptr->StartRefCount();
+        IntrusivePtr result;
+        result.object_ = ptr;
+        return result;
+    }
+
     // Observers
 
     T* Get() const {
@@ -192,14 +299,64 @@ public:
 private:
     T* object_;
 
-    template <typename Y, typename... Args>
-    friend IntrusivePtr<Y> MakeIntrusive(Args&&... args);
+    template <typename Y, typename U>
+    friend IntrusivePtr<Y> StaticPointerCast(IntrusivePtr<U>&& ptr) noexcept;
+
+    template <typename Y, typename U>
+    friend IntrusivePtr<Y> DynamicPointerCast(IntrusivePtr<U>&& ptr) noexcept;
+
+    template <typename Y, typename U>
+    friend IntrusivePtr<Y> ConstPointerCast(IntrusivePtr<U>&& ptr) noexcept;
 };
 
+template <typename T>
+struct IsTriviallyRelocatable<IntrusivePtr<T>> : std::true_type {};
+
+// The constructor of `T` must not hand out owners of the object (e.g. an IntrusivePtr to `this`
+// stored elsewhere): the count only starts after it returns, see AdoptNew
 template <typename T, typename... Args>
 IntrusivePtr<T> MakeIntrusive(Args&&... args) {
-    IntrusivePtr<T> ptr;
-    ptr.object_ = new T(std::forward<Args>(args)...);
-    ptr.object_->IncRef();
-    return ptr;
+    return IntrusivePtr<T>::AdoptNew(new T(std::forward<Args>(args)...));
+}
+
+// Casts. The overloads for rvalues take over the reference of `ptr` instead of adding one;
+// a failed DynamicPointerCast leaves `ptr` untouched. DynamicPointerCast memoizes its result
+// per dynamic type, see CachedDynamicCast.
+template <typename T, typename U>
+IntrusivePtr<T> StaticPointerCast(const IntrusivePtr<U>& ptr) {
+    return IntrusivePtr<T>(static_cast<T*>(ptr.Get()));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> StaticPointerCast(IntrusivePtr<U>&& ptr) noexcept {
+    IntrusivePtr<T> result;
+    result.object_ = static_cast<T*>(std::exchange(ptr.object_, nullptr));
+    return result;
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> DynamicPointerCast(const IntrusivePtr<U>& ptr) {
+    return IntrusivePtr<T>(CachedDynamicCast<T>(ptr.Get()));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> DynamicPointerCast(IntrusivePtr<U>&& ptr) noexcept {
+    IntrusivePtr<T> result;
+    if (auto object = CachedDynamicCast<T>(ptr.object_)) {
+        result.object_ = object;
+        ptr.object_ = nullptr;
+    }
+    return result;
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> ConstPointerCast(const IntrusivePtr<U>& ptr) {
+    return IntrusivePtr<T>(const_cast<T*>(ptr.Get()));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> ConstPointerCast(IntrusivePtr<U>&& ptr) noexcept {
+    IntrusivePtr<T> result;
+    result.object_ = const_cast<T*>(std::exchange(ptr.object_, nullptr));
+    return result;
 }
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "intrusive.h"
+
+#include <type_traits>
+
+// Borrowed reference to an object owned by IntrusivePtr: no count updates while it is passed
+// around, one increment to promote it to an owner. The owner must outlive the reference; debug
+// builds assert it when the object is destroyed.
+template <typename T>
+class IntrusiveRef {
+    template <typename Y>
+    friend class IntrusiveRef;
+
+public:
+    template <typename Y>
+        requires(std::is_convertible_v<Y*, T*>)
+    IntrusiveRef(const IntrusivePtr<Y>& owner) : object_(owner.Get()) {
+        AddBorrow();
+    }
+
+    template <typename Y>
+        requires(std::is_convertible_v<Y*, T*>)
+    IntrusiveRef(const IntrusiveRef<Y>& other) : object_(other.object_) {
+        AddBorrow();
+    }
+
+#ifndef NDEBUG
+    IntrusiveRef(const IntrusiveRef& other) : object_(other.object_) {
+        AddBorrow();
+    }
+
+    IntrusiveRef& operator=(const IntrusiveRef& other) {
+        if (this != &other) {
+            RemoveBorrow();
+            object_ = other.object_;
+            AddBorrow();
+        }
+        return *this;
+    }
+
+    ~IntrusiveRef() {
+        RemoveBorrow();
+    }
+#else
+    // Trivially copyable, so the reference is passed in a register like a raw pointer
+    IntrusiveRef(const IntrusiveRef&) = default;
+    IntrusiveRef& operator=(const IntrusiveRef&) = default;
+    ~IntrusiveRef() = default;
+#endif
+
+    // New owner of the object
+    IntrusivePtr<T> Promote() const {
+        if (!object_) {
+            return {};
+        }
+        return IntrusivePtr<T>(object_);
+    }
+
+    T* Get() const {
+        return object_;
+    }
+
+    T& operator*() const {
+        return *object_;
+    }
+
+    T* operator->() const {
+        return object_;
+    }
+
+    explicit operator bool() const {
+        return object_ != nullptr;
+    }
+
+private:
+    void AddBorrow() {
+#ifndef NDEBUG
+        if (object_) {
+            object_->borrows_.Add();
+        }
+#endif
+    }
+
+    void RemoveBorrow() {
+#ifndef NDEBUG
+        if (object_) {
+            object_->borrows_.Remove();
+        }
+#endif
+    }
+
+    T* object_;
+};
+
+template <typename T>
+struct IsTriviallyRelocatable<IntrusiveRef<T>> : std::true_type {};
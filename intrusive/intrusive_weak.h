@@ -0,0 +1,237 @@
+#pragma once
+
+#include "intrusive.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Created on the first weak reference to an object. From then on the strong counter lives here,
+// so a weak pointer can check it without touching a possibly destroyed object.
+struct WeakSideTable {
+    std::atomic<size_t> strong = 0;
+    // Weak pointers plus one for the object itself
+    std::atomic<size_t> weak = 1;
+
+    bool TryIncStrong() {
+        size_t count = strong.load(std::memory_order_relaxed);
+        while (count != 0) {
+            if (strong.compare_exchange_weak(count, count + 1, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void IncWeak() {
+        weak.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void DecWeak() {
+        if (weak.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+};
+
+// Atomic counter for RefCounted that takes a single word: either the strong count itself
+// (tagged with the lowest bit) or a pointer to the WeakSideTable once weak references exist.
+class WeakCounter {
+public:
+    WeakCounter() = default;
+
+    // A copy of an object is not referenced by anyone yet
+    WeakCounter(const WeakCounter&) {
+    }
+
+    WeakCounter& operator=(const WeakCounter&) {
+        return *this;
+    }
+
+    ~WeakCounter() {
+        uintptr_t state = state_.load(std::memory_order_acquire);
+        if (!IsInline(state)) {
+            ToTable(state)->DecWeak();
+        }
+    }
+
+    size_t IncRef() {
+        uintptr_t state = state_.load(std::memory_order_acquire);
+        while (IsInline(state)) {
+            if (state_.compare_exchange_weak(state, state + kOne, std::memory_order_acquire)) {
+                return (state >> 1) + 1;
+            }
+        }
+        return ToTable(state)->strong.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    size_t DecRef() {
+        uintptr_t state = state_.load(std::memory_order_acquire);
+        while (IsInline(state)) {
+            if (state_.compare_exchange_weak(state, state - kOne, std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+                return (state >> 1) - 1;
+            }
+        }
+        return ToTable(state)->strong.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    }
+
+    // First reference to an object nobody else sees yet: a plain store instead of a CAS
+    void Start() {
+        uintptr_t state = state_.load(std::memory_order_relaxed);
+        if (IsInline(state)) {
+            state_.store(kInlineTag + kOne, std::memory_order_relaxed);
+        } else {
+            IncRef();
+        }
+    }
+
+    // The object is about to be handed out again without being reconstructed (see ObjectPool).
+    // The side table is left to the old weak pointers, which keep seeing the object as expired.
+    void Restart() {
+        uintptr_t state = state_.exchange(kInlineTag, std::memory_order_acq_rel);
+        if (!IsInline(state)) {
+            ToTable(state)->DecWeak();
+        }
+    }
+
+    size_t RefCount() const {
+        uintptr_t state = state_.load(std::memory_order_acquire);
+        if (IsInline(state)) {
+            return state >> 1;
+        }
+        return ToTable(state)->strong.load(std::memory_order_relaxed);
+    }
+
+    // The caller must hold a strong reference
+    WeakSideTable* AcquireWeakTable() {
+        uintptr_t state = state_.load(std::memory_order_acquire);
+        if (!IsInline(state)) {
+            return ToTable(state);
+        }
+        auto table = new WeakSideTable;
+        do {
+            table->strong.store(state >> 1, std::memory_order_relaxed);
+            if (state_.compare_exchange_weak(state, reinterpret_cast<uintptr_t>(table),
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+                return table;
+            }
+        } while (IsInline(state));
+        delete table;
+        return ToTable(state);
+    }
+
+private:
+    static constexpr uintptr_t kInlineTag = 1;
+    static constexpr uintptr_t kOne = 2;
+
+    static bool IsInline(uintptr_t state) {
+        return state & kInlineTag;
+    }
+
+    static WeakSideTable* ToTable(uintptr_t state) {
+        return reinterpret_cast<WeakSideTable*>(state);
+    }
+
+    std::atomic<uintptr_t> state_ = kInlineTag;
+};
+
+template <typename Derived, typename D = DefaultDelete>
+using WeakRefCounted = RefCounted<Derived, WeakCounter, D>;
+
+// Weak reference to an object derived from WeakRefCounted
+template <typename T>
+class TRIVIAL_ABI IntrusiveWeakPtr {
+    template <typename Y>
+    friend class IntrusiveWeakPtr;
+
+public:
+    // Constructors
+    IntrusiveWeakPtr() : object_(nullptr), table_(nullptr) {
+    }
+
+    IntrusiveWeakPtr(const IntrusivePtr<T>& ptr) : object_(ptr.Get()), table_(nullptr) {
+        if (object_) {
+            table_ = object_->AcquireWeakTable();
+            table_->IncWeak();
+        }
+    }
+
+    IntrusiveWeakPtr(const IntrusiveWeakPtr& other) : object_(other.object_), table_(other.table_) {
+        if (table_) {
+            table_->IncWeak();
+        }
+    }
+
+    IntrusiveWeakPtr(IntrusiveWeakPtr&& other) noexcept
+        : object_(std::exchange(other.object_, nullptr)),
+          table_(std::exchange(other.table_, nullptr)) {
+    }
+
+    template <typename Y>
+    IntrusiveWeakPtr(const IntrusiveWeakPtr<Y>& other)
+        : object_(other.object_), table_(other.table_) {
+        if (table_) {
+            table_->IncWeak();
+        }
+    }
+
+    // `operator=`-s
+    IntrusiveWeakPtr& operator=(const IntrusiveWeakPtr& other) {
+        IntrusiveWeakPtr(other).Swap(*this);
+        return *this;
+    }
+
+    IntrusiveWeakPtr& operator=(IntrusiveWeakPtr&& other) noexcept {
+        IntrusiveWeakPtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    // Destructor
+    ~IntrusiveWeakPtr() {
+        if (table_) {
+            table_->DecWeak();
+        }
+    }
+
+    // Modifiers
+    void Reset() noexcept {
+        IntrusiveWeakPtr().Swap(*this);
+    }
+
+    void Swap(IntrusiveWeakPtr& other) noexcept {
+        std::swap(object_, other.object_);
+        std::swap(table_, other.table_);
+    }
+
+    // Observers
+    size_t UseCount() const {
+        if (table_) {
+            return table_->strong.load(std::memory_order_relaxed);
+        }
+        return 0;
+    }
+
+    bool Expired() const {
+        return UseCount() == 0;
+    }
+
+    // Lock-free: takes a strong reference only while the object is still alive
+    IntrusivePtr<T> Lock() const {
+        IntrusivePtr<T> ptr;
+        if (table_ && table_->TryIncStrong()) {
+            ptr.object_ = object_;
+        }
+        return ptr;
+    }
+
+private:
+    T* object_;
+    WeakSideTable* table_;
+};
+
+template <typename T>
+struct IsTriviallyRelocatable<IntrusiveWeakPtr<T>> : std::true_type {};
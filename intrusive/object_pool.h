@@ -0,0 +1,303 @@
+#pragma once
+
+#include "intrusive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class ObjectPool;
+
+// Instead of deleting the object, gives it back to the pool it came from
+struct PoolDelete {
+    template <typename T>
+    static void Destroy(T* object) {
+        object->home_->Release(object);
+    }
+};
+
+// Mixin for objects recycled by ObjectPool. If `Derived` has `OnReuse(args...)`, a reused object
+// is refreshed by it; otherwise it is destroyed and constructed again in place. Weak references
+// (with WeakCounter) do not follow an object back out of the pool.
+template <typename Derived, typename Counter = SimpleCounter>
+class PoolRefCounted : public RefCounted<Derived, Counter, PoolDelete> {
+private:
+    friend struct PoolDelete;
+    friend class ObjectPool<Derived>;
+
+    void Recycle() {
+        this->RestartRefCount();
+    }
+
+    ObjectPool<Derived>* home_ = nullptr;
+};
+
+struct PoolStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t trimmed = 0;
+};
+
+// Idle objects are kept in per-thread magazines, so most Allocate/Release calls take no lock.
+// Full magazines are traded with a shared depot under a mutex. Idle objects above `max_idle` are
+// deleted instead of being kept. A thread that exits gives its magazine back to the pool; the
+// pool deletes the idle objects left in the magazines of other threads when it is destroyed.
+template <typename T>
+class ObjectPool {
+public:
+    static constexpr size_t kMagazineSize = 32;
+
+    explicit ObjectPool(size_t max_idle = 1024) : max_idle_(max_idle) {
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    ~ObjectPool() {
+        assert(NumInUse() == 0 && "object outlived its pool");
+        std::lock_guard guard(registry_mutex_);
+        for (LocalMagazine* magazine : magazines_) {
+            DeleteAll(magazine->objects);
+            magazine->pool = nullptr;
+        }
+        for (auto& magazine : depot_) {
+            DeleteAll(magazine);
+        }
+    }
+
+    template <typename... Args>
+    IntrusivePtr<T> Allocate(Args&&... args) {
+        T* object = nullptr;
+        if (LocalMagazine* local = Local()) {
+            if (local->objects.empty()) {
+                Refill(local->objects);
+            }
+            if (!local->objects.empty()) {
+                object = local->objects.back();
+                local->objects.pop_back();
+            }
+        } else {
+            object = TakeFromDepot();
+        }
+
+        if (!object) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            object = new T(std::forward<Args>(args)...);
+            created_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            available_.fetch_sub(1, std::memory_order_relaxed);
+            Reuse(object, std::forward<Args>(args)...);
+        }
+        object->home_ = this;
+        return IntrusivePtr<T>::AdoptNew(object);
+    }
+
+    void Release(T* object) {
+        object->Recycle();
+        available_.fetch_add(1, std::memory_order_relaxed);
+        LocalMagazine* local = Local();
+        if (!local) {
+            PutToDepot({object});
+            return;
+        }
+        local->objects.push_back(object);
+        if (local->objects.size() == kMagazineSize) {
+            std::vector<T*> full;
+            full.swap(local->objects);
+            local->objects.reserve(kMagazineSize);
+            PutToDepot(std::move(full));
+        }
+    }
+
+    // Deletes all idle objects kept in the depot
+    void Trim() {
+        std::vector<std::vector<T*>> depot;
+        {
+            std::lock_guard guard(depot_mutex_);
+            depot.swap(depot_);
+        }
+        for (auto& magazine : depot) {
+            Drop(magazine);
+        }
+    }
+
+    size_t NumAvailable() const {
+        return available_.load(std::memory_order_relaxed);
+    }
+
+    size_t NumInUse() const {
+        return created_.load(std::memory_order_relaxed) - NumAvailable();
+    }
+
+    PoolStats GetStats() const {
+        return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+                trimmed_.load(std::memory_order_relaxed)};
+    }
+
+private:
+    // Idle objects of one thread, deleted by the thread when it exits
+    struct LocalMagazine {
+        ObjectPool* pool;  // nullptr once the pool is destroyed
+        std::vector<T*> objects;
+    };
+
+    // Magazines of the pools the current thread has used
+    struct LocalMagazines {
+        ~LocalMagazines() {
+            std::lock_guard guard(registry_mutex_);
+            for (auto& entry : entries) {
+                Leave(entry.second);
+            }
+            destroyed = true;
+        }
+
+        std::vector<std::pair<uint64_t, LocalMagazine*>> entries;
+
+        // Set once the thread is finishing; later calls on this thread go straight to the depot
+        static thread_local inline bool destroyed = false;
+    };
+
+    static uint64_t NextId() {
+        static std::atomic<uint64_t> next_id = 0;
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Pools are told apart by id, since a new pool can take the address of a destroyed one
+    LocalMagazine* Local() {
+        if (LocalMagazines::destroyed) {
+            return nullptr;
+        }
+        static thread_local LocalMagazines local;
+        for (auto& entry : local.entries) {
+            if (entry.first == id_) {
+                return entry.second;
+            }
+        }
+        return Register(local);
+    }
+
+    LocalMagazine* Register(LocalMagazines& local) {
+        auto magazine = new LocalMagazine{this, {}};
+        magazine->objects.reserve(kMagazineSize);
+        std::lock_guard guard(registry_mutex_);
+        std::erase_if(local.entries, [](const auto& entry) {
+            if (entry.second->pool) {
+                return false;
+            }
+            delete entry.second;
+            return true;
+        });
+        {
+            std::lock_guard depot_guard(depot_mutex_);
+            magazines_.push_back(magazine);
+        }
+        local.entries.emplace_back(id_, magazine);
+        return magazine;
+    }
+
+    // The idle objects go back to the depot if the pool is still alive
+    static void Leave(LocalMagazine* magazine) {
+        if (ObjectPool* pool = magazine->pool) {
+            {
+                std::lock_guard guard(pool->depot_mutex_);
+                std::erase(pool->magazines_, magazine);
+            }
+            if (!magazine->objects.empty()) {
+                pool->PutToDepot(std::move(magazine->objects));
+            }
+        }
+        delete magazine;
+    }
+
+    // On failure the object is dropped and the exception is passed to the caller
+    template <typename... Args>
+    void Reuse(T* object, Args&&... args) {
+        if constexpr (requires { object->OnReuse(std::forward<Args>(args)...); }) {
+            try {
+                object->OnReuse(std::forward<Args>(args)...);
+            } catch (...) {
+                created_.fetch_sub(1, std::memory_order_relaxed);
+                DeleteSized(object);
+                throw;
+            }
+        } else {
+            object->~T();
+            try {
+                new (object) T(std::forward<Args>(args)...);
+            } catch (...) {
+                created_.fetch_sub(1, std::memory_order_relaxed);
+                DeallocateSized<T>(object);
+                throw;
+            }
+        }
+    }
+
+    void Refill(std::vector<T*>& magazine) {
+        std::lock_guard guard(depot_mutex_);
+        if (!depot_.empty()) {
+            magazine.swap(depot_.back());
+            depot_.pop_back();
+        }
+    }
+
+    T* TakeFromDepot() {
+        std::lock_guard guard(depot_mutex_);
+        if (depot_.empty()) {
+            return nullptr;
+        }
+        T* object = depot_.back().back();
+        depot_.back().pop_back();
+        if (depot_.back().empty()) {
+            depot_.pop_back();
+        }
+        return object;
+    }
+
+    void PutToDepot(std::vector<T*> magazine) {
+        {
+            std::lock_guard guard(depot_mutex_);
+            if (NumAvailable() <= max_idle_) {
+                depot_.push_back(std::move(magazine));
+                return;
+            }
+        }
+        Drop(magazine);
+    }
+
+    void Drop(std::vector<T*>& magazine) {
+        available_.fetch_sub(magazine.size(), std::memory_order_relaxed);
+        created_.fetch_sub(magazine.size(), std::memory_order_relaxed);
+        trimmed_.fetch_add(magazine.size(), std::memory_order_relaxed);
+        DeleteAll(magazine);
+    }
+
+    static void DeleteAll(std::vector<T*>& magazine) {
+        for (T* object : magazine) {
+            DeleteSized(object);
+        }
+        magazine.clear();
+    }
+
+    const uint64_t id_ = NextId();
+    std::mutex depot_mutex_;
+    std::vector<std::vector<T*>> depot_;
+    std::vector<LocalMagazine*> magazines_;
+    size_t max_idle_;
+
+    // Orders threads that exit against pools that are destroyed
+    static inline std::mutex registry_mutex_;
+
+    std::atomic<size_t> created_ = 0;
+    std::atomic<size_t> available_ = 0;
+    std::atomic<size_t> hits_ = 0;
+    std::atomic<size_t> misses_ = 0;
+    std::atomic<size_t> trimmed_ = 0;
+};
@@ -1,10 +1,12 @@
 #include "intrusive.h"
+#include "object_pool.h"
 
 #include <catch.hpp>
 
 #include "allocations_checker.h"
 
 #include <string>
+#include <vector>
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -274,83 +276,13 @@ TEST_CASE("No copies") {
     IntrusivePtr<Pinned> p(new Pinned(1));
 }
 
-template <typename T>
-class ObjectInPool;
-
-template <typename T>
-class ObjectPool {
-    static_assert(std::is_base_of_v<ObjectInPool<T>, T>, "Unsupported type");
-
-public:
-    template <typename... Args>
-    IntrusivePtr<T> Allocate(Args&&... args) {
-        if (!objects_.empty()) {
-            std::unique_ptr<T> ptr = std::move(objects_.back());
-            objects_.pop_back();
-            return IntrusivePtr<T>(ptr.release());
-        }
-        return DoAllocate(std::forward<Args>(args)...);
-    }
-
-    void Release(T* ptr) {
-        objects_.emplace_back(ptr);
-    }
-
-    size_t NumAvailable() const {
-        return objects_.size();
-    }
-
-    size_t NumInUse() const {
-        return allocated_ - NumAvailable();
-    }
+struct PoolableString : PoolRefCounted<PoolableString>, std::string {
+    using std::string::basic_string;
 
-private:
+    // Reused strings keep their old value
     template <typename... Args>
-    IntrusivePtr<T> DoAllocate(Args&&... args) {
-        ++allocated_;
-        std::unique_ptr<T> object = std::make_unique<T>(std::forward<Args>(args)...);
-        object->SetHome(this);
-        return IntrusivePtr<T>(object.release());
+    void OnReuse(Args&&...) {
     }
-
-private:
-    std::vector<std::unique_ptr<T>> objects_;
-    size_t allocated_ = 0;
-};
-
-template <typename Derived>
-class ObjectInPool {
-public:
-    void IncRef() {
-        count_++;
-    }
-
-    void DecRef() {
-        if (--count_ == 0) {
-            TakeMeHome();
-        }
-    }
-
-    size_t RefCount() const {
-        return count_;
-    }
-
-    void SetHome(ObjectPool<Derived>* pool) {
-        home_ = pool;
-    }
-
-private:
-    void TakeMeHome() {
-        home_->Release(static_cast<Derived*>(this));
-    }
-
-private:
-    size_t count_ = 0;
-    ObjectPool<Derived>* home_;
-};
-
-struct PoolableString : ObjectInPool<PoolableString>, std::string {
-    using std::string::basic_string;
 };
 
 TEST_CASE("Object pool") {
@@ -397,3 +329,151 @@ TEST_CASE("Object pool") {
         REQUIRE(strs.NumInUse() == 1);
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct CountingCounter : SimpleCounter {
+    size_t IncRef() {
+        ++operations;
+        return SimpleCounter::IncRef();
+    }
+
+    size_t DecRef() {
+        ++operations;
+        return SimpleCounter::DecRef();
+    }
+
+    static inline size_t operations = 0;
+};
+
+struct Tracked : RefCounted<Tracked, CountingCounter, DefaultDelete> {};
+
+TEST_CASE("Vector growth moves pointers") {
+    constexpr size_t kCount = 100'000;
+    auto object = MakeIntrusive<Tracked>();
+    std::vector<IntrusivePtr<Tracked>> pointers;
+
+    CountingCounter::operations = 0;
+    for (size_t i = 0; i < kCount; ++i) {
+        pointers.push_back(object);
+    }
+    // One increment per copy and nothing on reallocations
+    REQUIRE(CountingCounter::operations == kCount);
+    REQUIRE(object->RefCount() == kCount + 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct Shape : SimpleRefCounted<Shape> {
+    virtual ~Shape() = default;
+};
+
+struct Square : Shape {
+    int side = 3;
+};
+
+struct Triangle : Shape {};
+
+TEST_CASE("Pointer casts") {
+    SECTION("Copies add a reference") {
+        IntrusivePtr<Shape> shape = MakeIntrusive<Square>();
+        auto square = StaticPointerCast<Square>(shape);
+        REQUIRE(square->side == 3);
+        REQUIRE(shape.UseCount() == 2);
+
+        REQUIRE(DynamicPointerCast<Square>(shape).Get() == square.Get());
+        REQUIRE(!DynamicPointerCast<Triangle>(shape));
+        REQUIRE(shape.UseCount() == 2);
+
+        IntrusivePtr<const Square> constant = square;
+        REQUIRE(shape.UseCount() == 3);
+        ConstPointerCast<Square>(constant)->side = 4;
+        REQUIRE(constant->side == 4);
+    }
+
+    SECTION("Rvalues steal the reference") {
+        IntrusivePtr<Shape> shape = MakeIntrusive<Square>();
+        IntrusivePtr<Square> square;
+        EXPECT_ZERO_ALLOCATIONS(square = StaticPointerCast<Square>(std::move(shape)));
+        REQUIRE(!shape);
+        REQUIRE(square.UseCount() == 1);
+
+        auto back = DynamicPointerCast<Shape>(std::move(square));
+        REQUIRE(!square);
+        REQUIRE(back.UseCount() == 1);
+
+        auto triangle = DynamicPointerCast<Triangle>(std::move(back));
+        REQUIRE(!triangle);
+        REQUIRE(back.UseCount() == 1);
+
+        auto constant = ConstPointerCast<const Shape>(std::move(back));
+        REQUIRE(constant.UseCount() == 1);
+    }
+
+    SECTION("Null") {
+        IntrusivePtr<Shape> empty;
+        REQUIRE(!StaticPointerCast<Square>(empty));
+        REQUIRE(!DynamicPointerCast<Square>(empty));
+        REQUIRE(!IntrusivePtr<Shape>(static_cast<Shape*>(nullptr)));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Stands for a C API that keeps an opaque context and hands it back later
+struct Callback {
+    void (*function)(void*) = nullptr;
+    void* context = nullptr;
+
+    void Fire() {
+        function(context);
+    }
+};
+
+static void OnFire(void* context) {
+    auto ptr = IntrusivePtr<MyString>::Adopt(static_cast<MyString*>(context));
+    ptr->append("!");
+}
+
+TEST_CASE("Adopt and Detach") {
+    SECTION("MakeIntrusive starts at one") {
+        auto ptr = MakeIntrusive<MyString>("fresh");
+        REQUIRE(ptr.UseCount() == 1);
+    }
+
+    SECTION("Round trip keeps the count") {
+        auto ptr = MakeIntrusive<MyString>("round");
+        auto copy = ptr;
+        MyString* raw = copy.Detach();
+        REQUIRE(!copy);
+        REQUIRE(ptr.UseCount() == 2);
+
+        auto adopted = IntrusivePtr<MyString>::Adopt(raw);
+        REQUIRE(adopted.Get() == ptr.Get());
+        REQUIRE(ptr.UseCount() == 2);
+        adopted.Reset();
+        REQUIRE(ptr.UseCount() == 1);
+    }
+
+    SECTION("Callback context") {
+        auto ptr = MakeIntrusive<MyString>("fired");
+        Callback callback{&OnFire, IntrusivePtr(ptr).Detach()};
+        REQUIRE(ptr.UseCount() == 2);
+        callback.Fire();
+        REQUIRE(ptr.UseCount() == 1);
+        REQUIRE(*ptr == "fired!");
+    }
+
+    SECTION("Sole owner") {
+        MyString* raw = MakeIntrusive<MyString>("alone").Detach();
+        REQUIRE(raw->RefCount() == 1);
+        auto ptr = IntrusivePtr<MyString>::Adopt(raw);
+        REQUIRE(ptr.UseCount() == 1);
+    }
+
+    SECTION("Null") {
+        IntrusivePtr<MyString> empty;
+        REQUIRE(empty.Detach() == nullptr);
+        REQUIRE(!IntrusivePtr<MyString>::Adopt(nullptr));
+    }
+}
@@ -0,0 +1,134 @@
+#include "intrusive.h"
+
+#include <common/bench.h>
+
+#include <catch.hpp>
+
+#include <new>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A hierarchy without a virtual destructor: the base knows the dynamic type from `kind` and
+// frees the object with its real size
+struct Expr : SimpleRefCounted<Expr> {
+    enum class Kind { kNumber, kSum };
+
+    explicit Expr(Kind kind) : kind(kind) {
+    }
+
+    static void operator delete(Expr* expr, std::destroying_delete_t);
+
+    int Eval() const;
+
+    Kind kind;
+};
+
+struct Number : Expr {
+    static int alive;
+
+    explicit Number(int value) : Expr(Kind::kNumber), value(value) {
+        ++alive;
+    }
+
+    ~Number() {
+        --alive;
+    }
+
+    int value;
+};
+
+int Number::alive = 0;
+
+struct Sum : Expr {
+    Sum(IntrusivePtr<Expr> left, IntrusivePtr<Expr> right)
+        : Expr(Kind::kSum), left(std::move(left)), right(std::move(right)) {
+    }
+
+    IntrusivePtr<Expr> left;
+    IntrusivePtr<Expr> right;
+};
+
+void Expr::operator delete(Expr* expr, std::destroying_delete_t) {
+    switch (expr->kind) {
+        case Kind::kNumber:
+            return DestroyAndDeallocate(static_cast<Number*>(expr));
+        case Kind::kSum:
+            return DestroyAndDeallocate(static_cast<Sum*>(expr));
+    }
+}
+
+int Expr::Eval() const {
+    switch (kind) {
+        case Kind::kNumber:
+            return static_cast<const Number*>(this)->value;
+        case Kind::kSum: {
+            auto sum = static_cast<const Sum*>(this);
+            return sum->left->Eval() + sum->right->Eval();
+        }
+    }
+    return 0;
+}
+
+TEST_CASE("Destroying delete") {
+    static_assert(!std::has_virtual_destructor_v<Expr>);
+
+    SECTION("Derived objects are destroyed through the base") {
+        {
+            IntrusivePtr<Expr> one = MakeIntrusive<Number>(1);
+            IntrusivePtr<Expr> tree = MakeIntrusive<Sum>(one, MakeIntrusive<Number>(2));
+            REQUIRE(tree->Eval() == 3);
+            REQUIRE(Number::alive == 2);
+        }
+        REQUIRE(Number::alive == 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct VirtualExpr : SimpleRefCounted<VirtualExpr> {
+    virtual ~VirtualExpr() = default;
+};
+
+struct VirtualNumber : VirtualExpr {
+    int value = 0;
+};
+
+// `delete` without the size, as before sized deallocation
+struct UnsizedDelete {
+    template <typename T>
+    static void Destroy(T* object) {
+        object->~T();
+        ::operator delete(object);
+    }
+};
+
+struct PlainNumber : RefCounted<PlainNumber, SimpleCounter, UnsizedDelete> {
+    int value = 0;
+};
+
+struct SizedNumber : SimpleRefCounted<SizedNumber> {
+    int value = 0;
+};
+
+template <typename Base, typename Make>
+static auto FreeTime(Make make) {
+    constexpr int kCount = 5'000'000;
+    std::vector<IntrusivePtr<Base>> objects;
+    objects.reserve(kCount);
+    for (int i = 0; i < kCount; ++i) {
+        objects.push_back(make());
+    }
+    return BenchMilliseconds([&] { objects.clear(); });
+}
+
+TEST_CASE("Free path benchmark", "[.][bench]") {
+    auto unsized = FreeTime<PlainNumber>([] { return MakeIntrusive<PlainNumber>(); });
+    auto sized = FreeTime<SizedNumber>([] { return MakeIntrusive<SizedNumber>(); });
+    auto virtual_destructor = FreeTime<VirtualExpr>(
+        [] { return IntrusivePtr<VirtualExpr>(MakeIntrusive<VirtualNumber>()); });
+    auto destroying =
+        FreeTime<Expr>([] { return IntrusivePtr<Expr>(MakeIntrusive<Number>(0)); });
+    WARN("unsized: " << unsized << "ms, sized: " << sized << "ms, virtual destructor: "
+                     << virtual_destructor << "ms, destroying delete: " << destroying << "ms");
+}
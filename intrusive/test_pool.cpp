@@ -0,0 +1,200 @@
+#include "intrusive.h"
+#include "intrusive_weak.h"
+#include "object_pool.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Buffer : PoolRefCounted<Buffer> {
+    static std::atomic<int> constructed;
+
+    Buffer(int tag) : tag(tag) {
+        ++constructed;
+    }
+
+    int tag;
+};
+
+std::atomic<int> Buffer::constructed = 0;
+
+struct Connection : PoolRefCounted<Connection> {
+    Connection(std::string host) : host(std::move(host)) {
+    }
+
+    void OnReuse(std::string new_host) {
+        host = std::move(new_host);
+        ++reuses;
+    }
+
+    std::string host;
+    int reuses = 0;
+};
+
+TEST_CASE("ObjectPool stats") {
+    ObjectPool<Buffer> pool;
+    { auto a = pool.Allocate(1); }
+    {
+        auto b = pool.Allocate(2);
+        REQUIRE(b->tag == 2);
+        REQUIRE(pool.NumInUse() == 1);
+        REQUIRE(pool.NumAvailable() == 0);
+    }
+    auto stats = pool.GetStats();
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 1);
+    REQUIRE(pool.NumAvailable() == 1);
+}
+
+TEST_CASE("ObjectPool reset hook") {
+    ObjectPool<Connection> pool;
+    { auto a = pool.Allocate("first"); }
+    auto b = pool.Allocate("second");
+    REQUIRE(b->host == "second");
+    REQUIRE(b->reuses == 1);
+    REQUIRE(b.UseCount() == 1);
+}
+
+struct Session : PoolRefCounted<Session, WeakCounter> {
+    Session(int user) : user(user) {
+    }
+
+    void OnReuse(int new_user) {
+        user = new_user;
+    }
+
+    int user;
+};
+
+TEST_CASE("ObjectPool drops weak references of released objects") {
+    ObjectPool<Session> pool;
+    IntrusiveWeakPtr<Session> stale;
+    Session* object;
+    {
+        auto first = pool.Allocate(1);
+        object = first.Get();
+        stale = first;
+        REQUIRE(stale.Lock()->user == 1);
+    }
+    REQUIRE(stale.Expired());
+
+    auto second = pool.Allocate(2);
+    REQUIRE(second.Get() == object);
+    REQUIRE(second.UseCount() == 1);
+    REQUIRE(!stale.Lock());
+
+    IntrusiveWeakPtr<Session> fresh(second);
+    REQUIRE(fresh.Lock()->user == 2);
+}
+
+TEST_CASE("ObjectPool destroys and constructs without hook") {
+    ObjectPool<Buffer> pool;
+    Buffer::constructed = 0;
+    { auto a = pool.Allocate(1); }
+    EXPECT_ZERO_ALLOCATIONS(auto b = pool.Allocate(2); REQUIRE(b->tag == 2););
+    REQUIRE(Buffer::constructed == 2);
+}
+
+TEST_CASE("ObjectPool trimming") {
+    constexpr size_t kCount = 4 * ObjectPool<Buffer>::kMagazineSize;
+    ObjectPool<Buffer> pool(ObjectPool<Buffer>::kMagazineSize);
+    {
+        std::vector<IntrusivePtr<Buffer>> buffers;
+        for (size_t i = 0; i < kCount; ++i) {
+            buffers.push_back(pool.Allocate(i));
+        }
+    }
+    REQUIRE(pool.GetStats().trimmed > 0);
+    REQUIRE(pool.NumAvailable() <= 2 * ObjectPool<Buffer>::kMagazineSize);
+    REQUIRE(pool.NumInUse() == 0);
+
+    pool.Trim();
+    REQUIRE(pool.NumAvailable() < ObjectPool<Buffer>::kMagazineSize);
+    REQUIRE(pool.NumInUse() == 0);
+}
+
+TEST_CASE("ObjectPool threads") {
+    ObjectPool<Buffer> pool;
+    std::atomic<int> mismatches = 0;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&pool, &mismatches, t] {
+            for (int i = 0; i < 1000; ++i) {
+                std::vector<IntrusivePtr<Buffer>> batch;
+                for (int j = 0; j < 40; ++j) {
+                    batch.push_back(pool.Allocate(t));
+                    if (batch.back()->tag != t) {
+                        ++mismatches;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(pool.NumInUse() == 0);
+    REQUIRE(pool.GetStats().hits > pool.GetStats().misses);
+}
+
+TEST_CASE("ObjectPool takes magazines back from finished threads") {
+    ObjectPool<Buffer> pool;
+    std::thread([&pool] {
+        std::vector<IntrusivePtr<Buffer>> batch;
+        for (int i = 0; i < 5; ++i) {
+            batch.push_back(pool.Allocate(i));
+        }
+    }).join();
+    REQUIRE(pool.NumAvailable() == 5);
+
+    std::vector<IntrusivePtr<Buffer>> batch;
+    for (int i = 0; i < 5; ++i) {
+        batch.push_back(pool.Allocate(i));
+    }
+    REQUIRE(pool.GetStats().hits == 5);
+}
+
+struct Job : PoolRefCounted<Job> {
+    static std::atomic<int> alive;
+
+    Job() {
+        ++alive;
+    }
+
+    ~Job() {
+        --alive;
+    }
+};
+
+std::atomic<int> Job::alive = 0;
+
+TEST_CASE("ObjectPool deletes idle objects of running threads") {
+    std::atomic<bool> released = false;
+    std::atomic<bool> destroyed = false;
+    std::thread worker;
+    {
+        ObjectPool<Job> pool;
+        worker = std::thread([&] {
+            { auto object = pool.Allocate(); }
+            released = true;
+            while (!destroyed) {
+                std::this_thread::yield();
+            }
+        });
+        while (!released) {
+            std::this_thread::yield();
+        }
+        REQUIRE(Job::alive == 1);
+    }
+    REQUIRE(Job::alive == 0);
+    destroyed = true;
+    worker.join();
+}
@@ -0,0 +1,57 @@
+#include "intrusive_ref.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Node : SimpleRefCounted<Node> {
+    explicit Node(std::string name) : name(std::move(name)) {
+    }
+
+    std::string name;
+};
+
+#ifdef NDEBUG
+static_assert(std::is_trivially_copyable_v<IntrusiveRef<Node>>);
+#endif
+
+static size_t NameLength(IntrusiveRef<Node> node) {
+    return node->name.size();
+}
+
+TEST_CASE("IntrusiveRef") {
+    SECTION("Borrowing does not touch the count") {
+        auto owner = MakeIntrusive<Node>("node");
+        IntrusiveRef<Node> ref = owner;
+        IntrusiveRef<Node> copy = ref;
+        REQUIRE(owner.UseCount() == 1);
+        REQUIRE(copy.Get() == owner.Get());
+        EXPECT_ZERO_ALLOCATIONS(REQUIRE(NameLength(owner) == 4));
+        REQUIRE(owner.UseCount() == 1);
+    }
+
+    SECTION("Promote takes one reference") {
+        auto owner = MakeIntrusive<Node>("kept");
+        std::vector<IntrusivePtr<Node>> kept;
+        IntrusiveRef<Node> ref = owner;
+        kept.push_back(ref.Promote());
+        REQUIRE(owner.UseCount() == 2);
+
+        owner.Reset();
+        REQUIRE(kept[0]->name == "kept");
+        REQUIRE(kept[0].UseCount() == 1);
+    }
+
+    SECTION("Empty owner") {
+        IntrusivePtr<Node> owner;
+        IntrusiveRef<Node> ref = owner;
+        REQUIRE(!ref);
+        REQUIRE(!ref.Promote());
+    }
+}
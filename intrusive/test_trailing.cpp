@@ -0,0 +1,106 @@
+#include "trailing.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct TextRecord : TrailingRefCounted<TextRecord, char> {
+    TextRecord(TrailingLength length, int id, std::string_view text)
+        : TrailingRefCounted(length), id(id) {
+        std::copy(text.begin(), text.end(), Trailing().begin());
+    }
+
+    std::string_view Text() const {
+        return {Trailing().data(), Trailing().size()};
+    }
+
+    int id;
+};
+
+struct Labels : TrailingRefCounted<Labels, std::string> {
+    static int alive;
+
+    explicit Labels(TrailingLength length) : TrailingRefCounted(length) {
+        ++alive;
+    }
+
+    ~Labels() {
+        --alive;
+    }
+};
+
+int Labels::alive = 0;
+
+struct RejectedRecord : TrailingRefCounted<RejectedRecord, std::string> {
+    explicit RejectedRecord(TrailingLength length) : TrailingRefCounted(length) {
+        Trailing()[0] = std::string(100, 'x');
+        throw std::runtime_error("rejected");
+    }
+};
+
+struct alignas(32) WideTail {
+    double values[4];
+};
+
+struct Samples : TrailingRefCounted<Samples, WideTail> {
+    using TrailingRefCounted::TrailingRefCounted;
+
+    char tag = 0;
+};
+
+TEST_CASE("MakeIntrusiveWithTrailing") {
+    SECTION("Object and payload share one allocation") {
+        std::string_view text = "a record longer than any small string buffer";
+        IntrusivePtr<TextRecord> record;
+        EXPECT_ONE_ALLOCATION(record = MakeIntrusiveWithTrailing<TextRecord>(text.size(), 7, text));
+        REQUIRE(record->id == 7);
+        REQUIRE(record->Text() == text);
+        REQUIRE(record->TrailingSize() == text.size());
+        REQUIRE(record->Trailing().data() == reinterpret_cast<char*>(record.Get() + 1));
+
+        auto copy = record;
+        REQUIRE(copy.UseCount() == 2);
+    }
+
+    SECTION("Elements are destroyed with the object") {
+        {
+            auto labels = MakeIntrusiveWithTrailing<Labels>(3);
+            labels->Trailing()[2] = std::string(100, 'l');
+            REQUIRE(labels->Trailing()[0].empty());
+            REQUIRE(Labels::alive == 1);
+        }
+        REQUIRE(Labels::alive == 0);
+    }
+
+    SECTION("Empty tail") {
+        auto record = MakeIntrusiveWithTrailing<TextRecord>(0, 1, "");
+        REQUIRE(record->Text().empty());
+    }
+
+    SECTION("A throwing constructor frees everything") {
+        REQUIRE_THROWS_AS(MakeIntrusiveWithTrailing<RejectedRecord>(2), std::runtime_error);
+    }
+
+    SECTION("Over-aligned elements") {
+        auto samples = MakeIntrusiveWithTrailing<Samples>(2);
+        auto tail = reinterpret_cast<std::uintptr_t>(samples->Trailing().data());
+        REQUIRE(tail % 32 == 0);
+        samples->Trailing()[1].values[3] = 1.5;
+        REQUIRE(samples->Trailing()[1].values[3] == 1.5);
+    }
+
+    SECTION("Lengths that overflow the allocation size") {
+        REQUIRE_THROWS_AS(MakeIntrusiveWithTrailing<Samples>(SIZE_MAX / sizeof(WideTail)),
+                          std::bad_array_new_length);
+        REQUIRE(MakeIntrusiveWithTrailing<Samples>(1).UseCount() == 1);
+    }
+}
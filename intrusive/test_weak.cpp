@@ -0,0 +1,123 @@
+#include "intrusive.h"
+#include "intrusive_weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Observed : WeakRefCounted<Observed> {
+    static int alive;
+
+    Observed(std::string name) : name(std::move(name)) {
+        ++alive;
+    }
+
+    ~Observed() {
+        --alive;
+    }
+
+    std::string name;
+};
+
+int Observed::alive = 0;
+
+TEST_CASE("Weak counter costs one word") {
+    static_assert(sizeof(WeakCounter) == sizeof(void*));
+    static_assert(sizeof(WeakRefCounted<Observed>) == sizeof(SimpleRefCounted<Observed>));
+}
+
+TEST_CASE("IntrusiveWeakPtr") {
+    SECTION("Empty") {
+        IntrusiveWeakPtr<Observed> wp;
+        REQUIRE(wp.Expired());
+        REQUIRE(wp.Lock().Get() == nullptr);
+    }
+
+    SECTION("MakeIntrusive starts the inline count at one") {
+        auto sp = MakeIntrusive<Observed>("x");
+        REQUIRE(sp.UseCount() == 1);
+        IntrusiveWeakPtr<Observed> wp(sp);
+        REQUIRE(wp.Lock().UseCount() == 2);
+        sp.Reset();
+        REQUIRE(wp.Expired());
+    }
+
+    SECTION("No side table without weak references") {
+        EXPECT_ONE_ALLOCATION({
+            auto sp = MakeIntrusive<Observed>("x");
+            auto copy = sp;
+            REQUIRE(copy.UseCount() == 2);
+        });
+    }
+
+    SECTION("Lock and expire") {
+        IntrusiveWeakPtr<Observed> wp;
+        {
+            auto sp = MakeIntrusive<Observed>("alive");
+            wp = sp;
+            REQUIRE(!wp.Expired());
+            REQUIRE(wp.UseCount() == 1);
+
+            auto locked = wp.Lock();
+            REQUIRE(locked->name == "alive");
+            REQUIRE(sp.UseCount() == 2);
+        }
+        REQUIRE(Observed::alive == 0);
+        REQUIRE(wp.Expired());
+        REQUIRE(wp.Lock().Get() == nullptr);
+    }
+
+    SECTION("Counts survive the switch to the side table") {
+        auto a = MakeIntrusive<Observed>("a");
+        auto b = a;
+        auto c = a;
+        IntrusiveWeakPtr<Observed> wp(a);
+        REQUIRE(a.UseCount() == 3);
+        b.Reset();
+        REQUIRE(wp.UseCount() == 2);
+        IntrusiveWeakPtr<Observed> copy = wp;
+        wp.Reset();
+        a.Reset();
+        c.Reset();
+        REQUIRE(copy.Expired());
+        REQUIRE(Observed::alive == 0);
+    }
+
+    SECTION("Side table is allocated once") {
+        auto sp = MakeIntrusive<Observed>("x");
+        IntrusiveWeakPtr<Observed> first(sp);
+        EXPECT_ZERO_ALLOCATIONS(IntrusiveWeakPtr<Observed> second(sp));
+    }
+}
+
+TEST_CASE("IntrusiveWeakPtr threads") {
+    for (int round = 0; round < 100; ++round) {
+        auto sp = MakeIntrusive<Observed>("shared");
+        IntrusiveWeakPtr<Observed> wp(sp);
+        std::atomic<int> wrong_names = 0;
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.emplace_back([wp, &wrong_names] {
+                for (int i = 0; i < 100; ++i) {
+                    if (auto locked = wp.Lock(); locked && locked->name != "shared") {
+                        ++wrong_names;
+                    }
+                }
+            });
+        }
+        sp.Reset();
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        REQUIRE(wrong_names == 0);
+        REQUIRE(wp.Expired());
+    }
+    REQUIRE(Observed::alive == 0);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "intrusive.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>  // std::destroy_n, std::uninitialized_default_construct_n
+#include <new>
+#include <span>
+#include <utility>
+
+template <typename Derived, typename Elem, typename Counter>
+class TrailingRefCounted;
+
+// Destroys the object and its trailing array, then frees the whole block with a sized delete
+struct TrailingDelete {
+    template <typename T>
+    static void Destroy(T* object) {
+        size_t size = object->TrailingSize();
+        auto tail = object->Trailing().data();
+        object->~T();
+        std::destroy_n(tail, size);
+        T::Deallocate(object, size);
+    }
+};
+
+// Length of the trailing array, passed by MakeIntrusiveWithTrailing as the first constructor
+// argument and forwarded to TrailingRefCounted. Only the factory can create it.
+class TrailingLength {
+public:
+    size_t Value() const {
+        return value_;
+    }
+
+private:
+    explicit TrailingLength(size_t value) : value_(value) {
+    }
+
+    template <typename T, typename... Args>
+    friend IntrusivePtr<T> MakeIntrusiveWithTrailing(size_t size, Args&&... args);
+
+    size_t value_;
+};
+
+// Mixin for objects followed by an array of `Elem` in the same allocation, e.g. the characters
+// of a string record. `Derived` must be the most derived type and is created only by
+// MakeIntrusiveWithTrailing. The array is alive already in the constructor of `Derived`.
+template <typename Derived, typename Elem = std::byte, typename Counter = SimpleCounter>
+class TrailingRefCounted : public RefCounted<Derived, Counter, TrailingDelete> {
+public:
+    std::span<Elem> Trailing() {
+        return {TrailingData(static_cast<Derived*>(this)), size_};
+    }
+
+    std::span<const Elem> Trailing() const {
+        return {TrailingData(const_cast<Derived*>(static_cast<const Derived*>(this))), size_};
+    }
+
+    size_t TrailingSize() const {
+        return size_;
+    }
+
+protected:
+    explicit TrailingRefCounted(TrailingLength length) : size_(length.Value()) {
+    }
+
+private:
+    friend struct TrailingDelete;
+
+    template <typename T, typename... Args>
+    friend IntrusivePtr<T> MakeIntrusiveWithTrailing(size_t size, Args&&... args);
+
+    static constexpr size_t TrailingOffset() {
+        return (sizeof(Derived) + alignof(Elem) - 1) / alignof(Elem) * alignof(Elem);
+    }
+
+    static constexpr size_t Align() {
+        return alignof(Derived) > alignof(Elem) ? alignof(Derived) : alignof(Elem);
+    }
+
+    static Elem* TrailingData(Derived* object) {
+        return reinterpret_cast<Elem*>(reinterpret_cast<char*>(object) + TrailingOffset());
+    }
+
+    static void* Allocate(size_t size) {
+        if (size > (SIZE_MAX - TrailingOffset()) / sizeof(Elem)) {
+            throw std::bad_array_new_length();
+        }
+        size_t bytes = TrailingOffset() + size * sizeof(Elem);
+        if constexpr (Align() > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return ::operator new(bytes, std::align_val_t(Align()));
+        } else {
+            return ::operator new(bytes);
+        }
+    }
+
+    static void Deallocate(void* memory, size_t size) {
+        size_t bytes = TrailingOffset() + size * sizeof(Elem);
+        if constexpr (Align() > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(memory, bytes, std::align_val_t(Align()));
+        } else {
+            ::operator delete(memory, bytes);
+        }
+    }
+
+    size_t size_;
+};
+
+// One allocation for `T(TrailingLength, args...)` followed by `size` default-initialized
+// elements (trivial types are left uninitialized)
+template <typename T, typename... Args>
+IntrusivePtr<T> MakeIntrusiveWithTrailing(size_t size, Args&&... args) {
+    void* memory = T::Allocate(size);
+    auto tail = T::TrailingData(static_cast<T*>(memory));
+    try {
+        std::uninitialized_default_construct_n(tail, size);
+    } catch (...) {
+        T::Deallocate(memory, size);
+        throw;
+    }
+    T* object;
+    try {
+        object = new (memory) T(TrailingLength(size), std::forward<Args>(args)...);
+    } catch (...) {
+        std::destroy_n(tail, size);
+        T::Deallocate(memory, size);
+        throw;
+    }
+    return IntrusivePtr<T>::AdoptNew(object);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>  // std::destroy_at
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Relocation (move to a new address and destroy the source) of such a type is a plain memcpy:
+// it does not point into itself and nothing points at it. Smart pointers opt in by specializing
+// the trait next to their definition.
+template <typename T>
+struct IsTriviallyRelocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+template <typename T>
+inline constexpr bool kIsTriviallyRelocatable = IsTriviallyRelocatable<std::remove_cv_t<T>>::value;
+
+// Moves `count` objects from `first` into uninitialized `dest` and ends the lifetime of the
+// sources. If a move throws, `dest` is left empty and the sources stay alive.
+template <typename T>
+T* UninitializedRelocate(T* first, size_t count, T* dest) {
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        if (count != 0) {
+            std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first),
+                        count * sizeof(T));
+        }
+    } else {
+        size_t done = 0;
+        try {
+            for (; done < count; ++done) {
+                new (dest + done) T(std::move_if_noexcept(first[done]));
+            }
+        } catch (...) {
+            std::destroy_n(dest, done);
+            throw;
+        }
+        std::destroy_n(first, count);
+    }
+    return dest + count;
+}
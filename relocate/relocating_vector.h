@@ -0,0 +1,155 @@
+#pragma once
+
+#include "relocate.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+// Vector that grows by relocation: trivially relocatable elements (all smart pointers here) are
+// moved with realloc/memcpy, without touching the elements themselves, so neither reference
+// counts nor moved-from states are involved. Other types go through UninitializedRelocate.
+template <typename T>
+class RelocatingVector {
+    static_assert(alignof(T) <= alignof(std::max_align_t));
+
+public:
+    RelocatingVector() = default;
+
+    RelocatingVector(const RelocatingVector&) = delete;
+    RelocatingVector& operator=(const RelocatingVector&) = delete;
+
+    RelocatingVector(RelocatingVector&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {
+    }
+
+    RelocatingVector& operator=(RelocatingVector&& other) noexcept {
+        RelocatingVector(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    ~RelocatingVector() {
+        Clear();
+        std::free(data_);
+    }
+
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        if (size_ < capacity_) {
+            new (data_ + size_) T(std::forward<Args>(args)...);
+        } else {
+            // The arguments may refer to an element, so the new one is built before growing
+            alignas(T) unsigned char element[sizeof(T)];
+            T* tmp = new (element) T(std::forward<Args>(args)...);
+            try {
+                Grow(std::max<size_t>(2 * capacity_, 8));
+            } catch (...) {
+                tmp->~T();
+                throw;
+            }
+            UninitializedRelocate(tmp, 1, data_ + size_);
+        }
+        return data_[size_++];
+    }
+
+    void PushBack(const T& value) {
+        EmplaceBack(value);
+    }
+
+    void PushBack(T&& value) {
+        EmplaceBack(std::move(value));
+    }
+
+    void PopBack() {
+        assert(size_ > 0);
+        std::destroy_at(data_ + --size_);
+    }
+
+    void Reserve(size_t capacity) {
+        if (capacity > capacity_) {
+            Grow(capacity);
+        }
+    }
+
+    void Clear() {
+        std::destroy_n(data_, size_);
+        size_ = 0;
+    }
+
+    void Swap(RelocatingVector& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    T& operator[](size_t ind) {
+        return data_[ind];
+    }
+
+    const T& operator[](size_t ind) const {
+        return data_[ind];
+    }
+
+    T* begin() {
+        return data_;
+    }
+
+    T* end() {
+        return data_ + size_;
+    }
+
+    const T* begin() const {
+        return data_;
+    }
+
+    const T* end() const {
+        return data_ + size_;
+    }
+
+private:
+    void Grow(size_t capacity) {
+        T* data;
+        if constexpr (kIsTriviallyRelocatable<T>) {
+            // realloc may extend the block in place and skip the copy altogether
+            data = static_cast<T*>(std::realloc(static_cast<void*>(data_), capacity * sizeof(T)));
+            if (!data) {
+                throw std::bad_alloc();
+            }
+        } else {
+            data = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+            if (!data) {
+                throw std::bad_alloc();
+            }
+            try {
+                UninitializedRelocate(data_, size_, data);
+            } catch (...) {
+                std::free(data);
+                throw;
+            }
+            std::free(data_);
+        }
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
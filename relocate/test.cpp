@@ -0,0 +1,194 @@
+#include "relocating_vector.h"
+
+#include <common/bench.h>
+#include <intrusive/intrusive.h>
+#include <shared-from-this/shared.h>
+#include <shared-from-this/weak.h>
+#include <unique/inline_unique.h>
+#include <unique/unique.h>
+
+#include <catch.hpp>
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Counted : SimpleRefCounted<Counted> {
+    int value = 0;
+};
+
+struct StatefulDelete {
+    StatefulDelete() = default;
+
+    StatefulDelete(const StatefulDelete&) {
+    }
+
+    void operator()(int* ptr) {
+        delete ptr;
+    }
+};
+
+static_assert(kIsTriviallyRelocatable<SharedPtr<std::string>>);
+static_assert(kIsTriviallyRelocatable<WeakPtr<std::string>>);
+static_assert(kIsTriviallyRelocatable<IntrusivePtr<Counted>>);
+static_assert(kIsTriviallyRelocatable<UniquePtr<std::string>>);
+static_assert(kIsTriviallyRelocatable<UniquePtr<int[]>>);
+static_assert(kIsTriviallyRelocatable<const UniquePtr<int>>);
+static_assert(!kIsTriviallyRelocatable<UniquePtr<int, StatefulDelete>>);
+static_assert(!kIsTriviallyRelocatable<InlineUniquePtr<int>>);
+static_assert(!kIsTriviallyRelocatable<std::string>);
+
+// Without the relocation trait std::vector still moves the pointers on reallocation, as long as
+// the moves cannot throw
+template <typename T>
+constexpr bool kNothrowMovable =
+    std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T> &&
+    std::is_nothrow_destructible_v<T> && noexcept(std::declval<T&>().Swap(std::declval<T&>()));
+
+static_assert(kNothrowMovable<SharedPtr<int>>);
+static_assert(kNothrowMovable<WeakPtr<int>>);
+static_assert(kNothrowMovable<IntrusivePtr<Counted>>);
+static_assert(kNothrowMovable<UniquePtr<int>>);
+static_assert(kNothrowMovable<UniquePtr<int[]>>);
+static_assert(kNothrowMovable<InlineUniquePtr<int>>);
+static_assert(std::is_nothrow_swappable_v<UniquePtr<int>>);
+
+// Counts the elements std::vector copies, i.e. the ones that touch a reference count
+template <typename T>
+struct CopyCountingAllocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        using other = CopyCountingAllocator<U>;
+    };
+
+    CopyCountingAllocator() = default;
+
+    template <typename U>
+    CopyCountingAllocator(const CopyCountingAllocator<U>&) {
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* ptr, Args&&... args) {
+        if constexpr ((std::is_lvalue_reference_v<Args> && ...) && sizeof...(Args) == 1) {
+            ++copies;
+        }
+        new (ptr) U(std::forward<Args>(args)...);
+    }
+
+    static inline size_t copies = 0;
+};
+
+TEST_CASE("Relocation") {
+    SECTION("UninitializedRelocate") {
+        alignas(std::string) unsigned char from[2 * sizeof(std::string)];
+        alignas(std::string) unsigned char to[2 * sizeof(std::string)];
+        auto source = reinterpret_cast<std::string*>(from);
+        auto dest = reinterpret_cast<std::string*>(to);
+        new (source) std::string("a");
+        new (source + 1) std::string(100, 'b');
+
+        REQUIRE(UninitializedRelocate(source, 2, dest) == dest + 2);
+        REQUIRE(dest[0] == "a");
+        REQUIRE(dest[1] == std::string(100, 'b'));
+        std::destroy_n(dest, 2);
+    }
+
+    SECTION("SharedPtr counts are left alone") {
+        auto object = MakeShared<int>(7);
+        WeakPtr<int> weak(object);
+        RelocatingVector<SharedPtr<int>> shared;
+        RelocatingVector<WeakPtr<int>> weaks;
+        for (int i = 0; i < 1000; ++i) {
+            shared.PushBack(object);
+            weaks.EmplaceBack(weak);
+        }
+        REQUIRE(object.UseCount() == 1001);
+        REQUIRE(*shared[999] == 7);
+        REQUIRE(weaks[500].Lock().Get() == object.Get());
+
+        shared.Clear();
+        REQUIRE(object.UseCount() == 1);
+    }
+
+    SECTION("Element that refers to the vector itself") {
+        RelocatingVector<SharedPtr<int>> shared;
+        shared.PushBack(MakeShared<int>(1));
+        for (int i = 0; i < 100; ++i) {
+            shared.PushBack(shared[0]);
+        }
+        REQUIRE(shared[0].UseCount() == 101);
+    }
+
+    SECTION("UniquePtr and IntrusivePtr") {
+        RelocatingVector<UniquePtr<std::string>> unique;
+        RelocatingVector<IntrusivePtr<Counted>> intrusive;
+        for (int i = 0; i < 100; ++i) {
+            unique.EmplaceBack(new std::string(std::to_string(i)));
+            intrusive.PushBack(MakeIntrusive<Counted>());
+            intrusive[i]->value = i;
+        }
+        REQUIRE(*unique[42] == "42");
+        REQUIRE(intrusive[42]->value == 42);
+        REQUIRE(intrusive[42]->RefCount() == 1);
+
+        unique.PopBack();
+        REQUIRE(unique.Size() == 99);
+    }
+
+    SECTION("Other types are moved") {
+        RelocatingVector<std::string> strings;
+        strings.Reserve(3);
+        REQUIRE(strings.Capacity() == 3);
+        for (int i = 0; i < 50; ++i) {
+            strings.PushBack(std::string(30, 'a' + i % 26));
+        }
+        REQUIRE(strings[27] == std::string(30, 'b'));
+
+        RelocatingVector<std::string> other(std::move(strings));
+        REQUIRE(strings.Empty());
+        REQUIRE(other.Size() == 50);
+    }
+}
+
+TEST_CASE("std::vector growth moves shared pointers") {
+    constexpr size_t kCount = 100'000;
+    auto object = MakeShared<int>(1);
+    WeakPtr<int> weak(object);
+    std::vector<SharedPtr<int>, CopyCountingAllocator<SharedPtr<int>>> shared;
+    std::vector<WeakPtr<int>, CopyCountingAllocator<WeakPtr<int>>> weaks;
+
+    CopyCountingAllocator<SharedPtr<int>>::copies = 0;
+    CopyCountingAllocator<WeakPtr<int>>::copies = 0;
+    for (size_t i = 0; i < kCount; ++i) {
+        shared.push_back(object);
+        weaks.push_back(weak);
+    }
+    // One copy per push_back and none on reallocations
+    REQUIRE(CopyCountingAllocator<SharedPtr<int>>::copies == kCount);
+    REQUIRE(CopyCountingAllocator<WeakPtr<int>>::copies == kCount);
+    REQUIRE(object.UseCount() == kCount + 1);
+}
+
+TEST_CASE("Relocation benchmark", "[.][bench]") {
+    constexpr int kCount = 10'000'000;
+    auto object = MakeShared<int>(1);
+
+    auto vector = BenchMilliseconds([&] {
+        std::vector<SharedPtr<int>> pointers;
+        for (int i = 0; i < kCount; ++i) {
+            pointers.push_back(object);
+        }
+    });
+    auto relocating = BenchMilliseconds([&] {
+        RelocatingVector<SharedPtr<int>> pointers;
+        for (int i = 0; i < kCount; ++i) {
+            pointers.PushBack(object);
+        }
+    });
+    REQUIRE(object.UseCount() == 1);
+    WARN("std::vector: " << vector << "ms, RelocatingVector: " << relocating << "ms");
+}
@@ -2,9 +2,16 @@
 
 #include "sw_fwd.h"  // Forward declaration
 
+#include <common/cached_cast.h>
+#include <common/trivial_abi.h>
+#include <unique/unique.h>
+
 #include <cstddef>  // std::nullptr_t
+#include <memory>   // std::allocator_traits
+#include <new>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 // class ESFTBase;
 // class EnableSharedFromThis : public ESFTBase;
@@ -13,6 +20,9 @@ template <typename T>
 class SharedPtr;
 class ESFTBase {};
 
+template <typename T, typename... Args>
+SharedPtr<T> MakeShared(Args&&... args);
+
 // Look for usage examples in tests
 template <typename T>
 class EnableSharedFromThis : public ESFTBase {
@@ -47,7 +57,7 @@ private:
 
 // https://en.cppreference.com/w/cpp/memory/shared_ptr
 template <typename T>
-class SharedPtr {
+class TRIVIAL_ABI SharedPtr {
 public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
@@ -75,13 +85,63 @@ public:
         }
     }
 
+    template <typename Y, typename Deleter>
+    SharedPtr(Y* ptr, Deleter deleter) : SharedPtr(ptr, std::move(deleter), std::allocator<Y>()) {
+    }
+
+    // The control block is allocated by `alloc` (rebound to the block type) and `deleter`
+    // releases the object. If the block cannot be allocated, `ptr` is passed to the deleter.
+    template <typename Y, typename Deleter, typename Alloc>
+    SharedPtr(Y* ptr, Deleter deleter, Alloc alloc) : observed_pole_(ptr) {
+        using Block = ControlBlockWithDeleter<Y, Deleter, Alloc>;
+        using Traits = std::allocator_traits<typename Block::BlockAlloc>;
+        typename Block::BlockAlloc block_alloc(alloc);
+        Block* block = nullptr;
+        try {
+            block = Traits::allocate(block_alloc, 1);
+        } catch (...) {
+            deleter(ptr);
+            throw;
+        }
+        cb_ = new (block) Block(ptr, std::move(deleter), block_alloc);
+        if constexpr (std::is_convertible_v<T*, ESFTBase*>) {
+            ptr->SetWeakPtr(*this);
+        }
+    }
+
+    // Takes over the object of `other`. Objects of MakeUniqueShareable already have room for the
+    // control block, so nothing is allocated; otherwise the deleter is kept in a new block.
+    template <typename Y, typename Deleter>
+        requires(!std::is_array_v<Y> && !std::is_reference_v<Deleter> &&
+                 std::is_same_v<typename UniquePtr<Y, Deleter>::Pointer, Y*>)
+    SharedPtr(UniquePtr<Y, Deleter>&& other) {
+        if (!other) {
+            return;
+        }
+        if constexpr (std::is_same_v<Deleter, ShareableDelete<Y>>) {
+            Y* ptr = other.Release();
+            cb_ = new (ShareableLayout<Y>::BlockOf(ptr)) ControlBlockShareable<Y>();
+            observed_pole_ = ptr;
+            if constexpr (std::is_convertible_v<T*, ESFTBase*>) {
+                ptr->SetWeakPtr(*this);
+            }
+        } else if constexpr (std::is_same_v<Deleter, Slug<Y>>) {
+            SharedPtr(other.Get()).Swap(*this);
+            other.Release();
+        } else {
+            // On failure the block constructor passes the object to the deleter
+            Y* ptr = other.Release();
+            SharedPtr(ptr, std::move(other.GetDeleter())).Swap(*this);
+        }
+    }
+
     SharedPtr(const SharedPtr& other) : cb_(other.cb_), observed_pole_(other.observed_pole_) {
         if (cb_) {
             cb_->IncrRef();
         }
     }
 
-    SharedPtr(SharedPtr&& other) : cb_(other.cb_), observed_pole_(other.observed_pole_) {
+    SharedPtr(SharedPtr&& other) noexcept : cb_(other.cb_), observed_pole_(other.observed_pole_) {
         other.cb_ = nullptr;
         other.observed_pole_ = nullptr;
     }
@@ -94,7 +154,8 @@ public:
     }
 
     template <typename U>
-    SharedPtr(SharedPtr<U>&& other) : cb_(other.cb_), observed_pole_(other.observed_pole_) {
+    SharedPtr(SharedPtr<U>&& other) noexcept
+        : cb_(other.cb_), observed_pole_(other.observed_pole_) {
         other.cb_ = nullptr;
         other.observed_pole_ = nullptr;
     }
@@ -108,7 +169,16 @@ public:
 
     template <typename Y>
     SharedPtr(const SharedPtr<Y>& other, T* ptr) : cb_(other.cb_), observed_pole_(ptr) {
-        other.cb_->IncrRef();
+        if (cb_) {
+            cb_->IncrRef();
+        }
+    }
+
+    // Takes over the reference of `other`, e.g. for a projection to a member of a temporary
+    template <typename Y>
+    SharedPtr(SharedPtr<Y>&& other, T* ptr) noexcept : cb_(other.cb_), observed_pole_(ptr) {
+        other.cb_ = nullptr;
+        other.observed_pole_ = nullptr;
     }
 
     // Promote `WeakPtr`
@@ -138,7 +208,7 @@ public:
         return *this;
     }
 
-    SharedPtr& operator=(SharedPtr&& other) {
+    SharedPtr& operator=(SharedPtr&& other) noexcept {
         if (this != &other) {
             if (cb_) {
                 cb_->DecrRef();
@@ -163,7 +233,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Modifiers
 
-    void Reset() {
+    void Reset() noexcept {
         if (cb_) {
             cb_->DecrRef();
         }
@@ -188,7 +258,38 @@ public:
         observed_pole_ = ptr;
     }
 
-    void Swap(SharedPtr& other) {
+    template <typename Y, typename Deleter>
+    void Reset(Y* ptr, Deleter deleter) {
+        SharedPtr(ptr, std::move(deleter)).Swap(*this);
+    }
+
+    // Replaces the object with `T(args...)`. A sole owner without weak references whose object
+    // lives in its control block (MakeShared, AllocateShared, MakeUniqueShareable) reconstructs
+    // it in place; otherwise this is `*this = MakeShared<T>(args...)`. If the constructor throws
+    // in place, the pointer becomes empty.
+    template <typename... Args>
+        requires(!std::is_const_v<T>)
+    T& Emplace(Args&&... args) {
+        if (cb_ && cb_->ref_count == 1 && cb_->weak_ref_count == 0 &&
+            cb_->GetInlineObject(&kInlineObjectTag<T>) == observed_pole_) {
+            observed_pole_->~T();
+            try {
+                new (observed_pole_) T(std::forward<Args>(args)...);
+            } catch (...) {
+                cb_->is_deleted = true;
+                Reset();
+                throw;
+            }
+            if constexpr (std::is_convertible_v<T*, ESFTBase*>) {
+                observed_pole_->SetWeakPtr(*this);
+            }
+        } else {
+            *this = MakeShared<T>(std::forward<Args>(args)...);
+        }
+        return *observed_pole_;
+    }
+
+    void Swap(SharedPtr& other) noexcept {
         std::swap(observed_pole_, other.observed_pole_);
         std::swap(cb_, other.cb_);
     }
@@ -208,6 +309,15 @@ public:
         return observed_pole_;
     }
 
+    // Returns the deleter the object was created with, or nullptr if it has a different type
+    template <typename Deleter>
+    Deleter* GetDeleter() const {
+        if (cb_) {
+            return static_cast<Deleter*>(cb_->GetDeleter(&kDeleterTag<Deleter>));
+        }
+        return nullptr;
+    }
+
     size_t UseCount() const {
         if (cb_) {
             return cb_->ref_count;
@@ -226,6 +336,20 @@ private:
 
     template <typename Y, typename... Args>
     friend SharedPtr<Y> MakeShared(Args&&... args);
+
+    template <typename Y, typename Alloc, typename... Args>
+    friend SharedPtr<Y> AllocateShared(const Alloc& alloc, Args&&... args);
+
+    template <typename Y, typename... Args>
+    friend std::vector<SharedPtr<Y>> MakeSharedBatch(size_t count, const Args&... args);
+
+    template <typename Y>
+    friend class SharedRef;
+
+    template <typename Y>
+    friend class TypedSharedPtr;
+
+    friend class Arena;
 };
 
 template <typename T, typename U>
@@ -233,6 +357,47 @@ inline bool operator==(const SharedPtr<T>& left, const SharedPtr<U>& right) {
     return left.Get() == right.Get();
 }
 
+// Casts. The overloads for rvalues take over the reference of `ptr` instead of adding one;
+// a failed DynamicPointerCast leaves `ptr` untouched. DynamicPointerCast memoizes its result
+// per dynamic type, see CachedDynamicCast.
+template <typename T, typename U>
+SharedPtr<T> StaticPointerCast(const SharedPtr<U>& ptr) {
+    return SharedPtr<T>(ptr, static_cast<T*>(ptr.Get()));
+}
+
+template <typename T, typename U>
+SharedPtr<T> StaticPointerCast(SharedPtr<U>&& ptr) noexcept {
+    auto object = static_cast<T*>(ptr.Get());
+    return SharedPtr<T>(std::move(ptr), object);
+}
+
+template <typename T, typename U>
+SharedPtr<T> DynamicPointerCast(const SharedPtr<U>& ptr) {
+    if (auto object = CachedDynamicCast<T>(ptr.Get())) {
+        return SharedPtr<T>(ptr, object);
+    }
+    return SharedPtr<T>();
+}
+
+template <typename T, typename U>
+SharedPtr<T> DynamicPointerCast(SharedPtr<U>&& ptr) noexcept {
+    if (auto object = CachedDynamicCast<T>(ptr.Get())) {
+        return SharedPtr<T>(std::move(ptr), object);
+    }
+    return SharedPtr<T>();
+}
+
+template <typename T, typename U>
+SharedPtr<T> ConstPointerCast(const SharedPtr<U>& ptr) {
+    return SharedPtr<T>(ptr, const_cast<T*>(ptr.Get()));
+}
+
+template <typename T, typename U>
+SharedPtr<T> ConstPointerCast(SharedPtr<U>&& ptr) noexcept {
+    auto object = const_cast<T*>(ptr.Get());
+    return SharedPtr<T>(std::move(ptr), object);
+}
+
 // Allocate memory only once
 template <typename T, typename... Args>
 SharedPtr<T> MakeShared(Args&&... args) {
@@ -254,3 +419,76 @@ SharedPtr<Y> MakeShared(Args&&... args) {
     ptr.observed_pole_ = static_cast<T*>(step_obj->GetObjectPtr());
     return ptr;
 }
+
+// Same as MakeShared, but the single allocation goes through `alloc`
+template <typename T, typename Alloc, typename... Args>
+SharedPtr<T> AllocateShared(const Alloc& alloc, Args&&... args) {
+    using Block = ControlBlockWithObjectAlloc<T, Alloc>;
+    using Traits = std::allocator_traits<typename Block::BlockAlloc>;
+    typename Block::BlockAlloc block_alloc(alloc);
+    Block* block = Traits::allocate(block_alloc, 1);
+    try {
+        new (block) Block(block_alloc, std::forward<Args>(args)...);
+    } catch (...) {
+        Traits::deallocate(block_alloc, block, 1);
+        throw;
+    }
+    SharedPtr<T> ptr;
+    ptr.cb_ = block;
+    ptr.observed_pole_ = static_cast<T*>(block->GetObjectPtr());
+    if constexpr (std::is_convertible_v<T*, ESFTBase*>) {
+        ptr.observed_pole_->SetWeakPtr(ptr);
+    }
+    return ptr;
+}
+
+// The object is placed after room for its control block, so converting the result to a
+// SharedPtr does not allocate. Until then it is an ordinary single-owner pointer.
+template <typename T, typename... Args>
+    requires(!std::is_array_v<T>)
+UniquePtr<T, ShareableDelete<T>> MakeUniqueShareable(Args&&... args) {
+    void* block = ShareableLayout<T>::Allocate();
+    T* object = nullptr;
+    try {
+        object = new (static_cast<char*>(block) + ShareableLayout<T>::kObjectOffset)
+            T(std::forward<Args>(args)...);
+    } catch (...) {
+        ShareableLayout<T>::Deallocate(block);
+        throw;
+    }
+    return UniquePtr<T, ShareableDelete<T>>(object);
+}
+
+// `count` independent owners of objects constructed from `args`. Their control blocks and
+// objects are laid out next to each other in one allocation, which is freed when the last
+// block goes away.
+template <typename T, typename... Args>
+std::vector<SharedPtr<T>> MakeSharedBatch(size_t count, const Args&... args) {
+    using Block = ControlBlockBatch<T>;
+    std::vector<SharedPtr<T>> result;
+    if (count == 0) {
+        return result;
+    }
+    BatchHeader* header = Block::AllocateBatch(count);
+    Block* blocks = Block::Blocks(header);
+    try {
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            new (blocks + i) Block(header, args...);
+            ++header->live;
+            SharedPtr<T>& ptr = result.emplace_back();
+            ptr.cb_ = blocks + i;
+            ptr.observed_pole_ = static_cast<T*>(blocks[i].GetObjectPtr());
+            if constexpr (std::is_convertible_v<T*, ESFTBase*>) {
+                ptr.observed_pole_->SetWeakPtr(ptr);
+            }
+        }
+    } catch (...) {
+        // Otherwise the pointers created so far free the batch
+        if (header->live == 0) {
+            Block::DeallocateBatch(header);
+        }
+        throw;
+    }
+    return result;
+}
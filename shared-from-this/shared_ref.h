@@ -0,0 +1,103 @@
+#pragma once
+
+#include "shared.h"
+
+#include <type_traits>
+
+// Borrowed reference to an object owned by a SharedPtr. Passing `SharedRef<T>` instead of
+// `const SharedPtr<T>&` costs no count updates, and a callee that needs to keep the object
+// promotes the reference to an owner with a single increment. The owner must outlive the
+// reference; debug builds assert it when the last owner goes away.
+template <typename T>
+class SharedRef {
+    template <typename Y>
+    friend class SharedRef;
+
+public:
+    template <typename Y>
+        requires(std::is_convertible_v<Y*, T*>)
+    SharedRef(const SharedPtr<Y>& owner) : cb_(owner.cb_), ptr_(owner.observed_pole_) {
+        AddBorrow();
+    }
+
+    template <typename Y>
+        requires(std::is_convertible_v<Y*, T*>)
+    SharedRef(const SharedRef<Y>& other) : cb_(other.cb_), ptr_(other.ptr_) {
+        AddBorrow();
+    }
+
+#ifndef NDEBUG
+    SharedRef(const SharedRef& other) : cb_(other.cb_), ptr_(other.ptr_) {
+        AddBorrow();
+    }
+
+    SharedRef& operator=(const SharedRef& other) {
+        if (this != &other) {
+            RemoveBorrow();
+            cb_ = other.cb_;
+            ptr_ = other.ptr_;
+            AddBorrow();
+        }
+        return *this;
+    }
+
+    ~SharedRef() {
+        RemoveBorrow();
+    }
+#else
+    // Trivially copyable, so the reference is passed in a register like a raw pointer
+    SharedRef(const SharedRef&) = default;
+    SharedRef& operator=(const SharedRef&) = default;
+    ~SharedRef() = default;
+#endif
+
+    // New owner of the object
+    SharedPtr<T> Promote() const {
+        SharedPtr<T> ptr;
+        if (cb_) {
+            cb_->IncrRef();
+            ptr.cb_ = cb_;
+            ptr.observed_pole_ = ptr_;
+        }
+        return ptr;
+    }
+
+    T* Get() const {
+        return ptr_;
+    }
+
+    T& operator*() const {
+        return *ptr_;
+    }
+
+    T* operator->() const {
+        return ptr_;
+    }
+
+    explicit operator bool() const {
+        return cb_ != nullptr;
+    }
+
+private:
+    void AddBorrow() {
+#ifndef NDEBUG
+        if (cb_) {
+            cb_->borrows.Add();
+        }
+#endif
+    }
+
+    void RemoveBorrow() {
+#ifndef NDEBUG
+        if (cb_) {
+            cb_->borrows.Remove();
+        }
+#endif
+    }
+
+    ControlBlockBase* cb_;
+    T* ptr_;
+};
+
+template <typename T>
+struct IsTriviallyRelocatable<SharedRef<T>> : std::true_type {};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+// Size-class allocator for control blocks: every thread keeps a free list of blocks of one size
+// and exchanges whole batches of them with a global depot, so most allocations and frees never
+// take a lock. Memory of the slabs is never given back to the system.
+
+constexpr size_t SlabSizeClass(size_t size) {
+    return (size + 15) / 16 * 16;
+}
+
+// A free block is reused as a list node until it is allocated again
+struct SlabFreeBlock {
+    SlabFreeBlock* next;
+    SlabFreeBlock* next_batch;
+    size_t batch_size;
+};
+
+template <size_t BlockSize>
+class SlabDepot {
+    static_assert(BlockSize >= sizeof(SlabFreeBlock) && BlockSize % 16 == 0);
+
+public:
+    static constexpr size_t kBatchSize = 32;
+    static constexpr size_t kSlabBytes = 64 * 1024;
+
+    // Never destroyed: blocks may be freed from destructors of other static objects
+    static SlabDepot& Instance() {
+        alignas(SlabDepot) static char storage[sizeof(SlabDepot)];
+        static SlabDepot* depot = new (storage) SlabDepot;
+        return *depot;
+    }
+
+    SlabFreeBlock* TakeBatch() {
+        std::lock_guard guard(mutex_);
+        if (!batches_) {
+            CarveSlab();
+        }
+        SlabFreeBlock* batch = batches_;
+        batches_ = batch->next_batch;
+        return batch;
+    }
+
+    void PutBatch(SlabFreeBlock* batch) {
+        std::lock_guard guard(mutex_);
+        batch->next_batch = batches_;
+        batches_ = batch;
+    }
+
+    size_t SlabCount() {
+        std::lock_guard guard(mutex_);
+        return slab_count_;
+    }
+
+private:
+    struct SlabHeader {
+        SlabHeader* next;
+    };
+
+    static constexpr size_t kHeaderBytes = SlabSizeClass(sizeof(SlabHeader));
+
+    void CarveSlab() {
+        char* memory = static_cast<char*>(::operator new(kSlabBytes));
+        slabs_ = new (memory) SlabHeader{slabs_};
+        ++slab_count_;
+
+        size_t block_count = (kSlabBytes - kHeaderBytes) / BlockSize;
+        char* blocks = memory + kHeaderBytes;
+        for (size_t first = 0; first < block_count; first += kBatchSize) {
+            size_t last = std::min(first + kBatchSize, block_count);
+            auto head = reinterpret_cast<SlabFreeBlock*>(blocks + first * BlockSize);
+            for (size_t i = first; i < last; ++i) {
+                auto block = reinterpret_cast<SlabFreeBlock*>(blocks + i * BlockSize);
+                block->next = (i + 1 < last)
+                                  ? reinterpret_cast<SlabFreeBlock*>(blocks + (i + 1) * BlockSize)
+                                  : nullptr;
+            }
+            head->batch_size = last - first;
+            head->next_batch = batches_;
+            batches_ = head;
+        }
+    }
+
+    std::mutex mutex_;
+    SlabFreeBlock* batches_ = nullptr;
+    SlabHeader* slabs_ = nullptr;
+    size_t slab_count_ = 0;
+};
+
+template <size_t BlockSize>
+class SlabCache {
+public:
+    using Depot = SlabDepot<BlockSize>;
+
+    static SlabCache* Local() {
+        if (destroyed) {
+            return nullptr;
+        }
+        static thread_local SlabCache cache;
+        return &cache;
+    }
+
+    void* Allocate() {
+        if (!head_) {
+            head_ = Depot::Instance().TakeBatch();
+            count_ = head_->batch_size;
+        }
+        SlabFreeBlock* block = head_;
+        head_ = block->next;
+        --count_;
+        return block;
+    }
+
+    void Deallocate(void* ptr) {
+        auto block = static_cast<SlabFreeBlock*>(ptr);
+        block->next = head_;
+        head_ = block;
+        ++count_;
+        if (count_ >= 2 * Depot::kBatchSize) {
+            ReturnBatch(Depot::kBatchSize);
+        }
+    }
+
+    ~SlabCache() {
+        while (count_ > 0) {
+            ReturnBatch(std::min(count_, Depot::kBatchSize));
+        }
+        destroyed = true;
+    }
+
+private:
+    void ReturnBatch(size_t size) {
+        SlabFreeBlock* batch = head_;
+        SlabFreeBlock* last = batch;
+        for (size_t i = 1; i < size; ++i) {
+            last = last->next;
+        }
+        head_ = last->next;
+        count_ -= size;
+        last->next = nullptr;
+        batch->batch_size = size;
+        Depot::Instance().PutBatch(batch);
+    }
+
+    SlabFreeBlock* head_ = nullptr;
+    size_t count_ = 0;
+
+    // Set once the thread is finishing; later frees on this thread go straight to the depot
+    static thread_local inline bool destroyed = false;
+};
+
+template <size_t Size>
+void* SlabAllocate() {
+    constexpr size_t kBlockSize = SlabSizeClass(Size);
+    if (auto cache = SlabCache<kBlockSize>::Local()) {
+        return cache->Allocate();
+    }
+    auto& depot = SlabDepot<kBlockSize>::Instance();
+    SlabFreeBlock* batch = depot.TakeBatch();
+    if (SlabFreeBlock* rest = batch->next) {
+        rest->batch_size = batch->batch_size - 1;
+        depot.PutBatch(rest);
+    }
+    return batch;
+}
+
+template <size_t Size>
+void SlabDeallocate(void* ptr) {
+    constexpr size_t kBlockSize = SlabSizeClass(Size);
+    if (auto cache = SlabCache<kBlockSize>::Local()) {
+        cache->Deallocate(ptr);
+        return;
+    }
+    auto block = static_cast<SlabFreeBlock*>(ptr);
+    block->next = nullptr;
+    block->batch_size = 1;
+    SlabDepot<kBlockSize>::Instance().PutBatch(block);
+}
@@ -1,7 +1,19 @@
 #pragma once
 
+#include "slab.h"
+
+#include <common/borrow_counter.h>
+#include <common/sized_delete.h>
+#include <relocate/relocate.h>
+#include <unique/compressed_pair.h>
+
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstdint>
 #include <exception>
+#include <memory>
+#include <new>
 
 class BadWeakPtr : public std::exception {};
 
@@ -11,10 +23,30 @@ class WeakPtr;
 template <typename T>
 class SharedPtr;
 
+// Both only hold pointers to the control block and the object
+template <typename T>
+struct IsTriviallyRelocatable<SharedPtr<T>> : std::true_type {};
+
+template <typename T>
+struct IsTriviallyRelocatable<WeakPtr<T>> : std::true_type {};
+
+class Arena;
+
+// Every deleter type gets a distinct address, so GetDeleter is a single pointer comparison
+template <typename Deleter>
+inline constexpr char kDeleterTag = 0;
+
+// Same for the types of objects stored inside their control block, see GetInlineObject
+template <typename T>
+inline constexpr char kInlineObjectTag = 0;
+
 struct ControlBlockBase {
     int ref_count = 1;
     int weak_ref_count = 0;
     bool is_deleted = false;
+#ifndef NDEBUG
+    BorrowCounter borrows;
+#endif
 
     bool IsRefZero() {
         return ((ref_count == 0) && (weak_ref_count == 0));
@@ -22,8 +54,11 @@ struct ControlBlockBase {
 
     void DecrRef() {
         --ref_count;
+#ifndef NDEBUG
+        assert((ref_count != 0 || borrows.Count() == 0) && "SharedRef outlived its object");
+#endif
         if (ref_count == 0 && weak_ref_count == 0) {
-            delete this;
+            DestroySelf();
         } else if (ref_count == 0) {
             SharedDestructor();
         }
@@ -37,7 +72,7 @@ struct ControlBlockBase {
         if (!flag) {
             --weak_ref_count;
             if (ref_count == 0 && weak_ref_count == 0) {
-                delete this;
+                DestroySelf();
             } else if (ref_count == 0) {
                 SharedDestructor();
             }
@@ -50,6 +85,22 @@ struct ControlBlockBase {
         }
     }
 
+    // Releases the memory of the block itself. Blocks created through an allocator
+    // override it to give the memory back to that allocator.
+    virtual void DestroySelf() {
+        delete this;
+    }
+
+    virtual void* GetDeleter(const void*) {
+        return nullptr;
+    }
+
+    // The storage of the object if the block holds a `T` inline (tag is kInlineObjectTag<T>),
+    // nullptr otherwise
+    virtual void* GetInlineObject(const void*) {
+        return nullptr;
+    }
+
     virtual void* GetObjectPtr() = 0;
     virtual ~ControlBlockBase() = default;
     virtual void SharedDestructor() = 0;
@@ -81,6 +132,16 @@ struct ControlBlockWithObject : ControlBlockBase {
         return reinterpret_cast<T*>(&buffer);
     }
 
+    void* GetInlineObject(const void* tag) {
+        return tag == &kInlineObjectTag<T> ? GetObjectPtr() : nullptr;
+    }
+
+    // Blocks of MakeShared; the derived blocks allocate themselves differently and override it
+    void DestroySelf() {
+        this->~ControlBlockWithObject();
+        DeallocateSized<ControlBlockWithObject>(this);
+    }
+
     alignas(T) std::array<char, sizeof(T)> buffer;
 };
 
@@ -94,7 +155,9 @@ struct ControlBlockWithPointer : ControlBlockBase {
 
     void SharedDestructor() {
         if (ref_count == 0 && !is_deleted) {
-            delete object;
+            if (object) {
+                DeleteSized(object);
+            }
             is_deleted = true;
         }
     }
@@ -103,9 +166,223 @@ struct ControlBlockWithPointer : ControlBlockBase {
         return object;
     }
 
+    // All these blocks have the same size, so they are packed densely into slabs
+    static void* operator new(size_t) {
+        return SlabAllocate<sizeof(ControlBlockWithPointer)>();
+    }
+
+    static void operator delete(void* ptr) {
+        SlabDeallocate<sizeof(ControlBlockWithPointer)>(ptr);
+    }
+
     ~ControlBlockWithPointer() {
         SharedDestructor();
     }
 
     T* object;
 };
+
+template <typename Alloc, typename Block>
+using ReboundAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Block>;
+
+// Same as ControlBlockWithObject, but the block is allocated and freed by `Alloc`
+template <typename T, typename Alloc>
+struct ControlBlockWithObjectAlloc
+    : ControlBlockWithObject<T>,
+      PairElem<0, ReboundAlloc<Alloc, ControlBlockWithObjectAlloc<T, Alloc>>> {
+    using BlockAlloc = ReboundAlloc<Alloc, ControlBlockWithObjectAlloc>;
+    using AllocElem = PairElem<0, BlockAlloc>;
+
+    template <typename... Args>
+    ControlBlockWithObjectAlloc(const BlockAlloc& alloc, Args&&... args)
+        : ControlBlockWithObject<T>(std::forward<Args>(args)...), AllocElem(alloc) {
+    }
+
+    void DestroySelf() {
+        BlockAlloc alloc(std::move(AllocElem::GetElem()));
+        this->~ControlBlockWithObjectAlloc();
+        std::allocator_traits<BlockAlloc>::deallocate(alloc, this, 1);
+    }
+};
+
+// Owns a pointer that is released by `Deleter`; the block itself lives in memory of `Alloc`
+template <typename T, typename Deleter, typename Alloc>
+struct ControlBlockWithDeleter : ControlBlockBase {
+    using BlockAlloc = ReboundAlloc<Alloc, ControlBlockWithDeleter>;
+
+    ControlBlockWithDeleter(T* obj, Deleter deleter, const BlockAlloc& alloc)
+        : data(obj, CompressedPair<Deleter, BlockAlloc>(std::move(deleter), BlockAlloc(alloc))) {
+        ref_count = 1;
+        weak_ref_count = 0;
+        is_deleted = false;
+    }
+
+    void SharedDestructor() {
+        if (ref_count == 0 && !is_deleted) {
+            data.GetSecond().GetFirst()(data.GetFirst());
+            is_deleted = true;
+        }
+    }
+
+    void* GetObjectPtr() {
+        return data.GetFirst();
+    }
+
+    void* GetDeleter(const void* tag) {
+        if (tag == &kDeleterTag<Deleter>) {
+            return &data.GetSecond().GetFirst();
+        }
+        return nullptr;
+    }
+
+    void DestroySelf() {
+        BlockAlloc alloc(std::move(data.GetSecond().GetSecond()));
+        this->~ControlBlockWithDeleter();
+        std::allocator_traits<BlockAlloc>::deallocate(alloc, this, 1);
+    }
+
+    ~ControlBlockWithDeleter() {
+        SharedDestructor();
+    }
+
+    // Stateless deleters and allocators take no space
+    CompressedPair<T*, CompressedPair<Deleter, BlockAlloc>> data;
+};
+
+// Memory of MakeUniqueShareable: the header of ControlBlockShareable is reserved in front of the
+// object but constructed only when the UniquePtr is converted to a SharedPtr
+template <typename T>
+struct ShareableLayout;
+
+template <typename T>
+struct ControlBlockShareable : ControlBlockBase {
+    ControlBlockShareable() {
+        ref_count = 1;
+        weak_ref_count = 0;
+        is_deleted = false;
+    }
+
+    void SharedDestructor() {
+        if (ref_count == 0 && !is_deleted) {
+            static_cast<T*>(GetObjectPtr())->~T();
+            is_deleted = true;
+        }
+    }
+
+    void* GetObjectPtr() {
+        return reinterpret_cast<char*>(this) + ShareableLayout<T>::kObjectOffset;
+    }
+
+    void* GetInlineObject(const void* tag) {
+        return tag == &kInlineObjectTag<T> ? GetObjectPtr() : nullptr;
+    }
+
+    void DestroySelf() {
+        this->~ControlBlockShareable();
+        ShareableLayout<T>::Deallocate(this);
+    }
+
+    ~ControlBlockShareable() {
+        SharedDestructor();
+    }
+};
+
+template <typename T>
+struct ShareableLayout {
+    using Block = ControlBlockShareable<T>;
+
+    static constexpr size_t kAlign = std::max(alignof(Block), alignof(T));
+    static constexpr size_t kObjectOffset =
+        (sizeof(Block) + alignof(T) - 1) / alignof(T) * alignof(T);
+    static constexpr size_t kSize = kObjectOffset + sizeof(T);
+    static constexpr bool kOverAligned = kAlign > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    static void* Allocate() {
+        if constexpr (kOverAligned) {
+            return ::operator new(kSize, std::align_val_t(kAlign));
+        } else {
+            return ::operator new(kSize);
+        }
+    }
+
+    static void Deallocate(void* memory) {
+        if constexpr (kOverAligned) {
+            ::operator delete(memory, kSize, std::align_val_t(kAlign));
+        } else {
+            ::operator delete(memory, kSize);
+        }
+    }
+
+    static void* BlockOf(T* object) {
+        return reinterpret_cast<char*>(object) - kObjectOffset;
+    }
+};
+
+// Deleter of MakeUniqueShareable: the object is destroyed together with the reserved header.
+// Stateless, so the UniquePtr stays one pointer wide.
+template <typename T>
+struct ShareableDelete {
+    void operator()(T* ptr) {
+        if (ptr) {
+            ptr->~T();
+            ShareableLayout<T>::Deallocate(ShareableLayout<T>::BlockOf(ptr));
+        }
+    }
+};
+
+// Shared memory of the blocks of MakeSharedBatch, freed with the last of them
+struct BatchHeader {
+    size_t live = 0;
+    size_t bytes = 0;
+};
+
+template <typename T>
+struct ControlBlockBatch : ControlBlockWithObject<T> {
+    template <typename... Args>
+    ControlBlockBatch(BatchHeader* header, const Args&... args)
+        : ControlBlockWithObject<T>(args...), header(header) {
+    }
+
+    static constexpr size_t kBlocksOffset =
+        (sizeof(BatchHeader) + alignof(ControlBlockBatch) - 1) / alignof(ControlBlockBatch) *
+        alignof(ControlBlockBatch);
+
+    static constexpr size_t kAlign = std::max(alignof(BatchHeader), alignof(ControlBlockBatch));
+
+    static BatchHeader* AllocateBatch(size_t count) {
+        if (count > (SIZE_MAX - kBlocksOffset) / sizeof(ControlBlockBatch)) {
+            throw std::bad_array_new_length();
+        }
+        size_t bytes = kBlocksOffset + count * sizeof(ControlBlockBatch);
+        void* memory;
+        if constexpr (kAlign > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            memory = ::operator new(bytes, std::align_val_t(kAlign));
+        } else {
+            memory = ::operator new(bytes);
+        }
+        return new (memory) BatchHeader{0, bytes};
+    }
+
+    static void DeallocateBatch(BatchHeader* header) {
+        if constexpr (kAlign > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(header, header->bytes, std::align_val_t(kAlign));
+        } else {
+            ::operator delete(header, header->bytes);
+        }
+    }
+
+    static ControlBlockBatch* Blocks(BatchHeader* header) {
+        return reinterpret_cast<ControlBlockBatch*>(reinterpret_cast<char*>(header) +
+                                                    kBlocksOffset);
+    }
+
+    void DestroySelf() {
+        BatchHeader* batch = header;
+        this->~ControlBlockBatch();
+        if (--batch->live == 0) {
+            DeallocateBatch(batch);
+        }
+    }
+
+    BatchHeader* header;
+};
@@ -0,0 +1,181 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct AllocStats {
+    int allocated = 0;
+    int deallocated = 0;
+};
+
+template <typename T>
+struct CountingAlloc {
+    using value_type = T;
+
+    CountingAlloc(AllocStats* stats) : stats(stats) {
+    }
+
+    template <typename U>
+    CountingAlloc(const CountingAlloc<U>& other) : stats(other.stats) {
+    }
+
+    T* allocate(size_t n) {
+        ++stats->allocated;
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) {
+        ++stats->deallocated;
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAlloc<U>& other) const {
+        return stats == other.stats;
+    }
+
+    AllocStats* stats;
+};
+
+struct Counted {
+    static int alive;
+
+    Counted(int value) : value(value) {
+        ++alive;
+    }
+
+    ~Counted() {
+        --alive;
+    }
+
+    int value;
+};
+
+int Counted::alive = 0;
+
+TEST_CASE("AllocateShared") {
+    AllocStats stats;
+
+    SECTION("Goes through the allocator") {
+        {
+            auto sp = AllocateShared<Counted>(CountingAlloc<Counted>(&stats), 42);
+            REQUIRE(sp->value == 42);
+            REQUIRE(sp.UseCount() == 1);
+            REQUIRE(Counted::alive == 1);
+            REQUIRE(stats.allocated == 1);
+            REQUIRE(stats.deallocated == 0);
+        }
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(stats.deallocated == 1);
+    }
+
+    SECTION("Weak references keep the block") {
+        WeakPtr<Counted> wp;
+        {
+            auto sp = AllocateShared<Counted>(CountingAlloc<Counted>(&stats), 1);
+            wp = sp;
+        }
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(wp.Expired());
+        REQUIRE(stats.deallocated == 0);
+        wp.Reset();
+        REQUIRE(stats.deallocated == 1);
+    }
+
+    SECTION("No extra allocations with std::allocator") {
+        EXPECT_ONE_ALLOCATION(REQUIRE(*AllocateShared<int>(std::allocator<int>(), 42) == 42));
+    }
+}
+
+TEST_CASE("Pointer with deleter and allocator") {
+    AllocStats stats;
+    int deleted = 0;
+    auto deleter = [&deleted](Counted* p) {
+        ++deleted;
+        delete p;
+    };
+
+    {
+        SharedPtr<Counted> sp(new Counted(7), deleter, CountingAlloc<int>(&stats));
+        SharedPtr<Counted> copy = sp;
+        REQUIRE(copy->value == 7);
+        REQUIRE(sp.UseCount() == 2);
+        REQUIRE(stats.allocated == 1);
+    }
+    REQUIRE(deleted == 1);
+    REQUIRE(Counted::alive == 0);
+    REQUIRE(stats.deallocated == 1);
+}
+
+TEST_CASE("Stateless allocator takes no space") {
+    using Block = ControlBlockWithObjectAlloc<int, std::allocator<int>>;
+    static_assert(sizeof(Block) == sizeof(ControlBlockWithObject<int>));
+}
+
+struct DefaultDeleter {
+    template <typename T>
+    void operator()(T* p) {
+        delete p;
+    }
+};
+
+struct Unmapper {
+    void operator()(Counted* p) {
+        ++calls;
+        delete p;
+    }
+
+    int calls = 0;
+};
+
+TEST_CASE("Custom deleter") {
+    SECTION("Called once for the last owner") {
+        int calls = 0;
+        {
+            SharedPtr<Counted> sp(new Counted(1), [&calls](Counted* p) {
+                ++calls;
+                delete p;
+            });
+            SharedPtr<Counted> copy = sp;
+            sp.Reset();
+            REQUIRE(calls == 0);
+        }
+        REQUIRE(calls == 1);
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Reset with deleter") {
+        SharedPtr<Counted> sp(new Counted(1));
+        sp.Reset(new Counted(2), Unmapper{});
+        REQUIRE(sp->value == 2);
+        REQUIRE(Counted::alive == 1);
+        REQUIRE(sp.GetDeleter<Unmapper>()->calls == 0);
+        sp.Reset();
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("GetDeleter") {
+        SharedPtr<Counted> plain(new Counted(1));
+        SharedPtr<Counted> custom(new Counted(2), Unmapper{});
+        REQUIRE(plain.GetDeleter<Unmapper>() == nullptr);
+        REQUIRE(custom.GetDeleter<Unmapper>() != nullptr);
+        REQUIRE(custom.GetDeleter<int>() == nullptr);
+        REQUIRE(SharedPtr<Counted>().GetDeleter<Unmapper>() == nullptr);
+    }
+
+    SECTION("Stateless deleter takes no space") {
+        using Block = ControlBlockWithDeleter<int, DefaultDeleter, std::allocator<int>>;
+        static_assert(sizeof(Block) == sizeof(ControlBlockWithPointer<int>));
+    }
+
+    SECTION("One allocation") {
+        int* ptr = new int(1);
+        EXPECT_ONE_ALLOCATION(SharedPtr<int> sp(ptr, DefaultDeleter{}));
+    }
+}
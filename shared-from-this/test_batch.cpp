@@ -0,0 +1,104 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct GraphNode {
+    static int alive;
+    static int fail_after;
+
+    GraphNode(const std::string& label) : label(label) {
+        if (fail_after >= 0 && alive == fail_after) {
+            throw std::runtime_error("node");
+        }
+        ++alive;
+    }
+
+    ~GraphNode() {
+        --alive;
+    }
+
+    std::string label;
+};
+
+int GraphNode::alive = 0;
+int GraphNode::fail_after = -1;
+
+struct alignas(64) AlignedNode {
+    int value = 1;
+};
+
+struct LinkedNode : EnableSharedFromThis<LinkedNode> {};
+
+TEST_CASE("MakeSharedBatch") {
+    SECTION("All blocks come from one slab") {
+        auto nodes = MakeSharedBatch<GraphNode>(1000, std::string("node"));
+        REQUIRE(nodes.size() == 1000);
+        auto first = reinterpret_cast<char*>(nodes[0].Get());
+        for (size_t i = 1; i < nodes.size(); ++i) {
+            REQUIRE(reinterpret_cast<char*>(nodes[i].Get()) - first ==
+                    static_cast<std::ptrdiff_t>(i * sizeof(ControlBlockBatch<GraphNode>)));
+        }
+        REQUIRE(GraphNode::alive == 1000);
+        REQUIRE(nodes[999]->label == "node");
+        REQUIRE(nodes[0].UseCount() == 1);
+        REQUIRE(nodes[0].Get() != nodes[1].Get());
+    }
+
+    SECTION("Objects are independent") {
+        auto nodes = MakeSharedBatch<GraphNode>(3, std::string("a"));
+        SharedPtr<GraphNode> survivor = nodes[1];
+        WeakPtr<GraphNode> weak = nodes[2];
+        nodes.clear();
+        REQUIRE(GraphNode::alive == 1);
+        REQUIRE(weak.Expired());
+        REQUIRE(survivor->label == "a");
+
+        survivor.Emplace("b");
+        REQUIRE(survivor->label == "b");
+    }
+
+    SECTION("Objects are laid out next to each other") {
+        auto nodes = MakeSharedBatch<AlignedNode>(4);
+        auto first = reinterpret_cast<std::uintptr_t>(nodes[0].Get());
+        auto last = reinterpret_cast<std::uintptr_t>(nodes[3].Get());
+        REQUIRE(first % 64 == 0);
+        REQUIRE(last % 64 == 0);
+        REQUIRE(last - first == 3 * sizeof(ControlBlockBatch<AlignedNode>));
+    }
+
+    SECTION("A throwing constructor destroys the objects built so far") {
+        GraphNode::fail_after = 5;
+        REQUIRE_THROWS_AS(MakeSharedBatch<GraphNode>(10, std::string("x")), std::runtime_error);
+        GraphNode::fail_after = 0;
+        REQUIRE_THROWS_AS(MakeSharedBatch<GraphNode>(10, std::string("x")), std::runtime_error);
+        GraphNode::fail_after = -1;
+        REQUIRE(GraphNode::alive == 0);
+    }
+
+    SECTION("Too many objects") {
+        REQUIRE_THROWS_AS(MakeSharedBatch<int>(SIZE_MAX / 8, 0), std::bad_array_new_length);
+        REQUIRE_THROWS_AS(MakeSharedBatch<int>(SIZE_MAX, 0), std::bad_array_new_length);
+    }
+
+    SECTION("EnableSharedFromThis") {
+        auto nodes = MakeSharedBatch<LinkedNode>(2);
+        REQUIRE(nodes[1]->SharedFromThis().Get() == nodes[1].Get());
+    }
+
+    SECTION("Empty batch") {
+        std::vector<SharedPtr<GraphNode>> nodes;
+        EXPECT_ZERO_ALLOCATIONS(nodes = MakeSharedBatch<GraphNode>(0, std::string("x")));
+        REQUIRE(nodes.empty());
+    }
+}
@@ -0,0 +1,151 @@
+#include "shared.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Animal {
+    virtual ~Animal() = default;
+};
+
+struct Cat : Animal {
+    std::string name = "cat";
+};
+
+struct Dog : Animal {};
+
+struct Point {
+    int x = 1;
+    int y = 2;
+};
+
+TEST_CASE("Aliasing") {
+    SECTION("Empty owner") {
+        int value = 5;
+        SharedPtr<int> empty;
+        SharedPtr<int> alias(empty, &value);
+        REQUIRE(alias.Get() == &value);
+        REQUIRE(alias.UseCount() == 0);
+    }
+
+    SECTION("Projection of a temporary") {
+        auto point = MakeShared<Point>();
+        SharedPtr<int> y(SharedPtr<Point>(point), &point->y);
+        REQUIRE(point.UseCount() == 2);
+
+        SharedPtr<int> x(std::move(point), &point->x);
+        REQUIRE(!point);
+        REQUIRE(x.UseCount() == 2);
+        REQUIRE(*x == 1);
+        y.Reset();
+        REQUIRE(x.UseCount() == 1);
+    }
+}
+
+TEST_CASE("Pointer casts") {
+    SECTION("Copies add a reference") {
+        SharedPtr<Animal> animal = MakeShared<Cat>();
+        auto cat = StaticPointerCast<Cat>(animal);
+        REQUIRE(cat->name == "cat");
+        REQUIRE(animal.UseCount() == 2);
+
+        auto dynamic = DynamicPointerCast<Cat>(animal);
+        REQUIRE(dynamic.Get() == cat.Get());
+        REQUIRE(!DynamicPointerCast<Dog>(animal));
+        REQUIRE(animal.UseCount() == 3);
+
+        SharedPtr<const Cat> constant = cat;
+        auto mutable_cat = ConstPointerCast<Cat>(constant);
+        mutable_cat->name = "changed";
+        REQUIRE(constant->name == "changed");
+    }
+
+    SECTION("Rvalues steal the reference") {
+        SharedPtr<Animal> animal = MakeShared<Cat>();
+        Animal* raw = animal.Get();
+        SharedPtr<Animal> copy = animal;
+
+        SharedPtr<Cat> cat;
+        EXPECT_ZERO_ALLOCATIONS(cat = StaticPointerCast<Cat>(std::move(animal)));
+        REQUIRE(!animal);
+        REQUIRE(cat.UseCount() == 2);
+
+        auto back = DynamicPointerCast<Animal>(std::move(cat));
+        REQUIRE(back.Get() == raw);
+        REQUIRE(back.UseCount() == 2);
+
+        auto constant = ConstPointerCast<const Animal>(std::move(back));
+        REQUIRE(constant.UseCount() == 2);
+    }
+
+    SECTION("Failed dynamic cast keeps the source") {
+        SharedPtr<Animal> animal = MakeShared<Dog>();
+        auto cat = DynamicPointerCast<Cat>(std::move(animal));
+        REQUIRE(!cat);
+        REQUIRE(animal);
+        REQUIRE(animal.UseCount() == 1);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Named {
+    virtual ~Named() = default;
+
+    std::string label = "named";
+};
+
+struct Top : virtual Animal {};
+
+struct Left : virtual Animal {
+    int left = 1;
+};
+
+struct Right : virtual Animal {
+    int right = 2;
+};
+
+struct Diamond : Named, Left, Right {};
+
+struct Other : Named, Cat {};
+
+TEST_CASE("Cached dynamic cast") {
+    SECTION("Same results as dynamic_cast") {
+        Diamond diamond;
+        Other other;
+        Cat cat;
+        Dog dog;
+        Animal* animals[] = {&diamond, static_cast<Cat*>(&other), &cat, &dog};
+        Named* names[] = {&diamond, &other};
+        for (int round = 0; round < 3; ++round) {
+            for (Animal* animal : animals) {
+                REQUIRE(CachedDynamicCast<Right>(animal) == dynamic_cast<Right*>(animal));
+                REQUIRE(CachedDynamicCast<Left>(animal) == dynamic_cast<Left*>(animal));
+                REQUIRE(CachedDynamicCast<Cat>(animal) == dynamic_cast<Cat*>(animal));
+                REQUIRE(CachedDynamicCast<Named>(animal) == dynamic_cast<Named*>(animal));
+                REQUIRE(CachedDynamicCast<const Dog>(static_cast<const Animal*>(animal)) ==
+                        dynamic_cast<const Dog*>(animal));
+            }
+            for (Named* named : names) {
+                REQUIRE(CachedDynamicCast<Right>(named) == dynamic_cast<Right*>(named));
+                REQUIRE(CachedDynamicCast<Animal>(named) == dynamic_cast<Animal*>(named));
+            }
+        }
+        REQUIRE(CachedDynamicCast<Right>(static_cast<Animal*>(nullptr)) == nullptr);
+    }
+
+    SECTION("Through SharedPtr") {
+        SharedPtr<Animal> animal = MakeShared<Diamond>();
+        for (int i = 0; i < 3; ++i) {
+            auto right = DynamicPointerCast<Right>(animal);
+            REQUIRE(right->right == 2);
+            REQUIRE(DynamicPointerCast<Named>(animal)->label == "named");
+            REQUIRE(!DynamicPointerCast<Cat>(animal));
+        }
+        REQUIRE(animal.UseCount() == 1);
+    }
+}
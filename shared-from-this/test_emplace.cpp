@@ -0,0 +1,99 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <stdexcept>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Quote {
+    static int alive;
+
+    Quote(int price, bool fail = false) : price(price) {
+        if (fail) {
+            throw std::runtime_error("quote");
+        }
+        ++alive;
+    }
+
+    ~Quote() {
+        --alive;
+    }
+
+    int price;
+};
+
+int Quote::alive = 0;
+
+struct Session : EnableSharedFromThis<Session> {
+    Session(int id) : id(id) {
+    }
+
+    int id;
+};
+
+TEST_CASE("SharedPtr Emplace") {
+    SECTION("Sole owner reuses the control block") {
+        auto ptr = MakeShared<Quote>(1);
+        Quote* object = ptr.Get();
+        EXPECT_ZERO_ALLOCATIONS(for (int i = 2; i < 100; ++i) { ptr.Emplace(i); });
+        REQUIRE(ptr.Get() == object);
+        REQUIRE(ptr->price == 99);
+        REQUIRE(Quote::alive == 1);
+    }
+
+    SECTION("Shareable objects") {
+        SharedPtr<Quote> ptr(MakeUniqueShareable<Quote>(1));
+        Quote* object = ptr.Get();
+        ptr.Emplace(2);
+        REQUIRE(ptr.Get() == object);
+        REQUIRE(ptr->price == 2);
+    }
+
+    SECTION("Other owners keep the old object") {
+        auto ptr = MakeShared<Quote>(1);
+        auto other = ptr;
+        REQUIRE(ptr.Emplace(2).price == 2);
+        REQUIRE(other->price == 1);
+        REQUIRE(ptr.UseCount() == 1);
+    }
+
+    SECTION("Weak references see the old object expire") {
+        auto ptr = MakeShared<Quote>(1);
+        WeakPtr<Quote> weak(ptr);
+        ptr.Emplace(2);
+        REQUIRE(weak.Expired());
+        REQUIRE(ptr->price == 2);
+    }
+
+    SECTION("Separately allocated objects") {
+        SharedPtr<Quote> ptr(new Quote(1));
+        ptr.Emplace(2);
+        REQUIRE(ptr->price == 2);
+        REQUIRE(Quote::alive == 1);
+    }
+
+    SECTION("Empty pointer") {
+        SharedPtr<Quote> ptr;
+        ptr.Emplace(3);
+        REQUIRE(ptr->price == 3);
+    }
+
+    SECTION("EnableSharedFromThis is rebound") {
+        auto ptr = MakeShared<Session>(1);
+        ptr.Emplace(2);
+        REQUIRE(ptr->SharedFromThis().Get() == ptr.Get());
+        REQUIRE(ptr.UseCount() == 1);
+    }
+
+    SECTION("A throwing constructor leaves the pointer empty") {
+        auto ptr = MakeShared<Quote>(1);
+        REQUIRE_THROWS_AS(ptr.Emplace(2, true), std::runtime_error);
+        REQUIRE(!ptr);
+        REQUIRE(Quote::alive == 0);
+    }
+}
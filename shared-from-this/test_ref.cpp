@@ -0,0 +1,77 @@
+#include "shared_ref.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Shape {
+    virtual ~Shape() = default;
+
+    int id = 1;
+};
+
+struct Circle : Shape {};
+
+#ifdef NDEBUG
+static_assert(std::is_trivially_copyable_v<SharedRef<std::string>>);
+#endif
+
+static size_t Length(SharedRef<std::string> str) {
+    return str->size();
+}
+
+static void Keep(SharedRef<Shape> ref, std::vector<SharedPtr<Shape>>& kept) {
+    kept.push_back(ref.Promote());
+}
+
+TEST_CASE("SharedRef") {
+    SECTION("Borrowing does not touch the count") {
+        auto owner = MakeShared<std::string>("borrowed");
+        SharedRef<std::string> ref = owner;
+        SharedRef<std::string> copy = ref;
+        REQUIRE(owner.UseCount() == 1);
+        REQUIRE(copy.Get() == owner.Get());
+        REQUIRE(*ref == "borrowed");
+        REQUIRE(Length(owner) == 8);
+        REQUIRE(owner.UseCount() == 1);
+    }
+
+    SECTION("Passing does not allocate") {
+        auto owner = MakeShared<std::string>(100, 'x');
+        EXPECT_ZERO_ALLOCATIONS(REQUIRE(Length(owner) == 100));
+    }
+
+    SECTION("Promote takes one reference") {
+        auto owner = MakeShared<Circle>();
+        std::vector<SharedPtr<Shape>> kept;
+        Keep(owner, kept);
+        REQUIRE(owner.UseCount() == 2);
+        REQUIRE(kept[0]->id == 1);
+
+        owner.Reset();
+        REQUIRE(kept[0].UseCount() == 1);
+    }
+
+    SECTION("Empty owner") {
+        SharedPtr<int> owner;
+        SharedRef<int> ref = owner;
+        REQUIRE(!ref);
+        REQUIRE(!ref.Promote());
+    }
+
+    SECTION("Assignment") {
+        auto first = MakeShared<int>(1);
+        auto second = MakeShared<int>(2);
+        SharedRef<int> ref = first;
+        ref = SharedRef<int>(second);
+        REQUIRE(*ref == 2);
+        first.Reset();
+        REQUIRE(*ref.Promote() == 2);
+    }
+}
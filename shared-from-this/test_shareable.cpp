@@ -0,0 +1,126 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Built {
+    static int alive;
+
+    Built(std::string name) : name(std::move(name)) {
+        ++alive;
+    }
+
+    ~Built() {
+        --alive;
+    }
+
+    std::string name;
+};
+
+int Built::alive = 0;
+
+struct alignas(64) Wide {
+    char bytes[64] = {};
+};
+
+struct FailingBuild {
+    FailingBuild() {
+        throw std::runtime_error("build");
+    }
+};
+
+struct Published : EnableSharedFromThis<Published> {
+    int value = 5;
+};
+
+struct TaggedDelete {
+    void operator()(int* ptr) {
+        ++*calls;
+        delete ptr;
+    }
+
+    int* calls;
+};
+
+TEST_CASE("UniquePtr to SharedPtr") {
+    SECTION("Shareable objects convert without allocating") {
+        auto unique = MakeUniqueShareable<Built>("builder");
+        static_assert(sizeof(unique) == sizeof(void*));
+        unique->name += " pattern";
+
+        Built* object = unique.Get();
+        SharedPtr<Built> shared;
+        EXPECT_ZERO_ALLOCATIONS(shared = SharedPtr<Built>(std::move(unique)));
+        REQUIRE(!unique);
+        REQUIRE(shared.Get() == object);
+        REQUIRE(shared->name == "builder pattern");
+        REQUIRE(shared.UseCount() == 1);
+
+        shared.Reset();
+        REQUIRE(Built::alive == 0);
+    }
+
+    SECTION("Shareable object that is never shared") {
+        { auto unique = MakeUniqueShareable<Built>("alone"); }
+        REQUIRE(Built::alive == 0);
+    }
+
+    SECTION("Weak references keep the header alive") {
+        WeakPtr<Built> weak;
+        {
+            SharedPtr<Built> shared(MakeUniqueShareable<Built>("weak"));
+            weak = shared;
+            REQUIRE(weak.Lock()->name == "weak");
+        }
+        REQUIRE(Built::alive == 0);
+        REQUIRE(weak.Expired());
+    }
+
+    SECTION("Over-aligned objects") {
+        auto unique = MakeUniqueShareable<Wide>();
+        REQUIRE(reinterpret_cast<std::uintptr_t>(unique.Get()) % 64 == 0);
+        SharedPtr<Wide> shared(std::move(unique));
+        REQUIRE(shared->bytes[63] == 0);
+    }
+
+    SECTION("A throwing constructor frees the memory") {
+        REQUIRE_THROWS_AS(MakeUniqueShareable<FailingBuild>(), std::runtime_error);
+    }
+
+    SECTION("EnableSharedFromThis") {
+        SharedPtr<Published> shared(MakeUniqueShareable<Published>());
+        REQUIRE(shared->SharedFromThis().Get() == shared.Get());
+        REQUIRE(shared.UseCount() == 1);
+    }
+
+    SECTION("Plain UniquePtr") {
+        UniquePtr<Built> unique(new Built("plain"));
+        SharedPtr<Built> shared(std::move(unique));
+        REQUIRE(!unique);
+        REQUIRE(shared->name == "plain");
+    }
+
+    SECTION("The deleter is kept") {
+        int calls = 0;
+        UniquePtr<int, TaggedDelete> unique(new int(3), TaggedDelete{&calls});
+        SharedPtr<int> shared(std::move(unique));
+        REQUIRE(shared.GetDeleter<TaggedDelete>()->calls == &calls);
+        shared.Reset();
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("Empty") {
+        SharedPtr<Built> from_shareable(UniquePtr<Built, ShareableDelete<Built>>{});
+        SharedPtr<Built> from_plain(UniquePtr<Built>{});
+        REQUIRE(!from_shareable);
+        REQUIRE(!from_plain);
+    }
+}
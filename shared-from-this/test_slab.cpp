@@ -0,0 +1,129 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <common/bench.h>
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct PlainDelete {
+    void operator()(int* p) {
+        delete p;
+    }
+};
+
+TEST_CASE("Slab control blocks") {
+    SECTION("Blocks are reused") {
+        std::vector<int*> objects;
+        for (int i = 0; i < 10000; ++i) {
+            objects.push_back(new int(i));
+        }
+        { SharedPtr<int> warm_up(new int(0)); }
+
+        EXPECT_ZERO_ALLOCATIONS(for (int* object : objects) {
+            SharedPtr<int> sp(object);
+            REQUIRE(sp.UseCount() == 1);
+        });
+    }
+
+    SECTION("Plain new path allocates every block") {
+        int* object = new int(1);
+        EXPECT_ONE_ALLOCATION(SharedPtr<int> sp(object, PlainDelete{}));
+    }
+
+    SECTION("Blocks are packed densely") {
+        constexpr size_t kSize = 200;
+        auto first = static_cast<char*>(SlabAllocate<kSize>());
+        auto second = static_cast<char*>(SlabAllocate<kSize>());
+        REQUIRE(second - first == static_cast<ptrdiff_t>(SlabSizeClass(kSize)));
+        REQUIRE(SlabDepot<SlabSizeClass(kSize)>::Instance().SlabCount() == 1);
+        SlabDeallocate<kSize>(second);
+        SlabDeallocate<kSize>(first);
+    }
+
+    SECTION("Weak references keep the block") {
+        // A fresh thread starts with an empty cache, which hands blocks out in LIFO order
+        constexpr size_t kBlockSize = sizeof(ControlBlockWithPointer<int>);
+        bool kept = false;
+        bool reused = false;
+        std::thread owner([&] {
+            void* probe = SlabAllocate<kBlockSize>();
+            SlabDeallocate<kBlockSize>(probe);
+
+            WeakPtr<int> wp;
+            {
+                SharedPtr<int> sp(new int(42));
+                wp = sp;
+            }
+            void* other = SlabAllocate<kBlockSize>();
+            kept = wp.Expired() && other != probe;
+            SlabDeallocate<kBlockSize>(other);
+
+            wp.Reset();
+            void* next = SlabAllocate<kBlockSize>();
+            reused = next == probe;
+            SlabDeallocate<kBlockSize>(next);
+        });
+        owner.join();
+        REQUIRE(kept);
+        REQUIRE(reused);
+    }
+
+    SECTION("Frees from other threads") {
+        // More blocks than a few slabs hold, so losing them would force new slabs
+        using Depot = SlabDepot<SlabSizeClass(sizeof(ControlBlockWithPointer<int>))>;
+        constexpr size_t kWorkers = 4;
+        constexpr size_t kCount = 4 * Depot::kSlabBytes / sizeof(ControlBlockWithPointer<int>);
+
+        std::vector<SharedPtr<int>> ptrs;
+        for (size_t i = 0; i < kCount; ++i) {
+            ptrs.emplace_back(new int(0));
+        }
+        size_t slabs = Depot::Instance().SlabCount();
+
+        // The releaser hands the blocks back to the depot when it exits
+        std::thread releaser([&ptrs] { ptrs.clear(); });
+        releaser.join();
+
+        // Each worker may strand up to a batch in its own cache
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < kWorkers; ++t) {
+            workers.emplace_back([] {
+                std::vector<SharedPtr<int>> local;
+                for (size_t i = 0; i < kCount / kWorkers - Depot::kBatchSize; ++i) {
+                    local.emplace_back(new int(0));
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        REQUIRE(Depot::Instance().SlabCount() == slabs);
+    }
+}
+
+TEST_CASE("Slab benchmark", "[.][bench]") {
+    constexpr int kIterations = 1'000'000;
+    std::vector<int*> objects;
+    for (int i = 0; i < kIterations; ++i) {
+        objects.push_back(new int(i));
+    }
+
+    auto slab = BenchMilliseconds([&] {
+        for (int i = 0; i < kIterations / 2; ++i) {
+            SharedPtr<int> sp(objects[i]);
+        }
+    });
+    auto plain = BenchMilliseconds([&] {
+        for (int i = kIterations / 2; i < kIterations; ++i) {
+            SharedPtr<int> sp(objects[i], PlainDelete{});
+        }
+    });
+    WARN("slab: " << slab << "ms, new: " << plain << "ms");
+}
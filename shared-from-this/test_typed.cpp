@@ -0,0 +1,130 @@
+#include "typed_shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <cstdint>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Tick {
+    long long time = 0;
+    double price = 0;
+};
+
+struct Order {
+    static int alive;
+
+    explicit Order(std::string client) : client(std::move(client)) {
+        ++alive;
+    }
+
+    ~Order() {
+        --alive;
+    }
+
+    std::string client;
+};
+
+int Order::alive = 0;
+
+struct LimitOrder final : Order {
+    using Order::Order;
+
+    int limit = 10;
+};
+
+struct Account : EnableSharedFromThis<Account> {
+    int balance = 0;
+};
+
+struct alignas(64) CacheLine {
+    int value = 0;
+};
+
+static_assert(kIsTriviallyRelocatable<TypedSharedPtr<Tick>>);
+
+TEST_CASE("TypedSharedPtr") {
+    SECTION("Copies share the object") {
+        TypedSharedPtr<Tick> tick;
+        EXPECT_ONE_ALLOCATION(tick = MakeTypedShared<Tick>(Tick{1, 2.5}));
+        auto copy = tick;
+        REQUIRE(tick.UseCount() == 2);
+        REQUIRE(copy->price == 2.5);
+        REQUIRE(copy.Get() == tick.Get());
+
+        TypedSharedPtr<Tick> moved(std::move(copy));
+        REQUIRE(!copy);
+        REQUIRE(copy.Get() == nullptr);
+        REQUIRE(tick.UseCount() == 2);
+        moved.Reset();
+        REQUIRE(tick.UseCount() == 1);
+    }
+
+    SECTION("Empty pointers") {
+        TypedSharedPtr<Tick> tick;
+        REQUIRE(tick.operator->() == nullptr);
+        REQUIRE(tick.Get() == nullptr);
+    }
+
+    SECTION("Over-aligned objects") {
+        auto line = MakeTypedShared<CacheLine>();
+        REQUIRE(reinterpret_cast<uintptr_t>(line.Get()) % 64 == 0);
+        line->value = 1;
+        auto copy = line;
+        line.Reset();
+        REQUIRE(copy->value == 1);
+    }
+
+    SECTION("Objects with destructors") {
+        {
+            auto order = MakeTypedShared<Order>("a client name longer than the buffer");
+            auto copy = order;
+            copy = MakeTypedShared<Order>("other");
+            REQUIRE(Order::alive == 2);
+        }
+        REQUIRE(Order::alive == 0);
+    }
+
+    SECTION("Converts to SharedPtr") {
+        auto order = MakeTypedShared<LimitOrder>("client");
+        SharedPtr<Order> erased = order;
+        REQUIRE(order.UseCount() == 2);
+        REQUIRE(erased.Get() == order.Get());
+
+        SharedPtr<LimitOrder> moved = std::move(order);
+        REQUIRE(!order);
+        REQUIRE(moved.UseCount() == 2);
+        moved.Reset();
+        REQUIRE(Order::alive == 1);
+        erased.Reset();
+        REQUIRE(Order::alive == 0);
+    }
+
+    SECTION("Weak references through SharedPtr") {
+        WeakPtr<Order> weak;
+        {
+            auto order = MakeTypedShared<Order>("client");
+            weak = SharedPtr<Order>(order);
+            REQUIRE(weak.Lock()->client == "client");
+        }
+        REQUIRE(Order::alive == 0);
+        REQUIRE(weak.Expired());
+    }
+
+    SECTION("EnableSharedFromThis") {
+        auto account = MakeTypedShared<Account>();
+        REQUIRE(account.UseCount() == 1);
+        REQUIRE(account->SharedFromThis().Get() == account.Get());
+    }
+
+    SECTION("Self-assignment") {
+        auto tick = MakeTypedShared<Tick>();
+        auto& same = tick;
+        tick = same;
+        REQUIRE(tick.UseCount() == 1);
+    }
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "shared.h"
+
+#include <common/sized_delete.h>
+#include <common/trivial_abi.h>
+
+#include <cassert>
+#include <cstddef>  // std::nullptr_t
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Block of MakeTypedShared. It is final, so calls through a pointer to it are not virtual.
+template <typename T>
+struct ControlBlockTyped final : ControlBlockWithObject<T> {
+    using ControlBlockWithObject<T>::ControlBlockWithObject;
+
+    void SharedDestructor() {
+        if constexpr (std::is_trivially_destructible_v<T>) {
+            this->is_deleted = true;
+        } else {
+            ControlBlockWithObject<T>::SharedDestructor();
+        }
+    }
+
+    void DestroySelf() {
+        this->~ControlBlockTyped();
+        DeallocateSized<ControlBlockTyped>(this);
+    }
+
+    ~ControlBlockTyped() {
+        SharedDestructor();
+    }
+};
+
+// Owner of an object created by MakeTypedShared. It knows the exact type of the control block,
+// so copies and the release of the object and the block are inlined instead of going through
+// virtual calls. Converts to SharedPtr (sharing the same block) where the type must be erased.
+template <typename T>
+class TRIVIAL_ABI TypedSharedPtr {
+    using Block = ControlBlockTyped<T>;
+
+public:
+    TypedSharedPtr() = default;
+
+    TypedSharedPtr(std::nullptr_t) {
+    }
+
+    TypedSharedPtr(const TypedSharedPtr& other) : block_(other.block_) {
+        if (block_) {
+            ++block_->ref_count;
+        }
+    }
+
+    TypedSharedPtr(TypedSharedPtr&& other) noexcept : block_(std::exchange(other.block_, nullptr)) {
+    }
+
+    TypedSharedPtr& operator=(const TypedSharedPtr& other) {
+        TypedSharedPtr(other).Swap(*this);
+        return *this;
+    }
+
+    TypedSharedPtr& operator=(TypedSharedPtr&& other) noexcept {
+        TypedSharedPtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    ~TypedSharedPtr() {
+        Release();
+    }
+
+    void Reset() noexcept {
+        Release();
+        block_ = nullptr;
+    }
+
+    void Swap(TypedSharedPtr& other) noexcept {
+        std::swap(block_, other.block_);
+    }
+
+    T* Get() const {
+        return block_ ? Object() : nullptr;
+    }
+
+    T& operator*() const {
+        return *Get();
+    }
+
+    T* operator->() const {
+        return Get();
+    }
+
+    size_t UseCount() const {
+        return block_ ? block_->ref_count : 0;
+    }
+
+    explicit operator bool() const {
+        return block_ != nullptr;
+    }
+
+    // Type-erased owner of the same object
+    template <typename U>
+        requires(std::is_convertible_v<T*, U*>)
+    operator SharedPtr<U>() const& {
+        SharedPtr<U> ptr;
+        if (block_) {
+            ++block_->ref_count;
+            ptr.cb_ = block_;
+            ptr.observed_pole_ = Object();
+        }
+        return ptr;
+    }
+
+    template <typename U>
+        requires(std::is_convertible_v<T*, U*>)
+    operator SharedPtr<U>() && {
+        SharedPtr<U> ptr;
+        if (block_) {
+            ptr.observed_pole_ = Object();
+            ptr.cb_ = std::exchange(block_, nullptr);
+        }
+        return ptr;
+    }
+
+private:
+    template <typename Y, typename... Args>
+    friend TypedSharedPtr<Y> MakeTypedShared(Args&&... args);
+
+    T* Object() const {
+        return static_cast<T*>(block_->GetObjectPtr());
+    }
+
+    // Same steps as ControlBlockBase::DecrRef, without the virtual calls
+    void Release() {
+        if (!block_ || --block_->ref_count != 0) {
+            return;
+        }
+#ifndef NDEBUG
+        assert(block_->borrows.Count() == 0 && "SharedRef outlived its object");
+#endif
+        if (block_->weak_ref_count == 0) {
+            block_->DestroySelf();
+        } else {
+            block_->SharedDestructor();
+        }
+    }
+
+    Block* block_ = nullptr;
+};
+
+template <typename T>
+struct IsTriviallyRelocatable<TypedSharedPtr<T>> : std::true_type {};
+
+template <typename T, typename... Args>
+TypedSharedPtr<T> MakeTypedShared(Args&&... args) {
+    using Block = ControlBlockTyped<T>;
+    // Freed by Block::DestroySelf with the same size and alignment
+    void* memory = AllocateSized<Block>();
+    TypedSharedPtr<T> ptr;
+    try {
+        ptr.block_ = new (memory) Block(std::forward<Args>(args)...);
+    } catch (...) {
+        DeallocateSized<Block>(memory);
+        throw;
+    }
+    if constexpr (std::is_convertible_v<T*, ESFTBase*>) {
+        ptr->SetWeakPtr(SharedPtr<T>(ptr));
+    }
+    return ptr;
+}
@@ -2,9 +2,11 @@
 
 #include "sw_fwd.h"  // Forward declaration
 
+#include <common/trivial_abi.h>
+
 // https://en.cppreference.com/w/cpp/memory/weak_ptr
 template <typename T>
-class WeakPtr {
+class TRIVIAL_ABI WeakPtr {
 public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
@@ -27,7 +29,7 @@ public:
         }
     }
 
-    WeakPtr(WeakPtr&& other)
+    WeakPtr(WeakPtr&& other) noexcept
         : cb_(other.cb_), observed_pole_(other.observed_pole_), is_this_weak_(other.is_this_weak_) {
         other.cb_ = nullptr;
         other.observed_pole_ = nullptr;
@@ -58,7 +60,7 @@ public:
         return *this;
     }
 
-    WeakPtr& operator=(WeakPtr&& other) {
+    WeakPtr& operator=(WeakPtr&& other) noexcept {
         if (cb_) {
             cb_->DecrWeakRef(is_this_weak_);
         }
@@ -86,7 +88,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Modifiers
 
-    void Reset() {
+    void Reset() noexcept {
         if (cb_) {
             cb_->DecrWeakRef(is_this_weak_);
             cb_ = nullptr;
@@ -94,7 +96,7 @@ public:
         }
     }
 
-    void Swap(WeakPtr& other) {
+    void Swap(WeakPtr& other) noexcept {
         std::swap(cb_, other.cb_);
         std::swap(observed_pole_, other.observed_pole_);
     }
@@ -2,6 +2,8 @@
 
 #include "sw_fwd.h"  // Forward declaration
 
+#include <common/trivial_abi.h>
+
 #include <cstddef>  // std::nullptr_t
 #include <utility>
 
@@ -48,7 +50,7 @@ struct ControlBlockWithPointer : ControlBlockBase {
 
 // https://en.cppreference.com/w/cpp/memory/shared_ptr
 template <typename T>
-class SharedPtr {
+class TRIVIAL_ABI SharedPtr {
 public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
@@ -73,7 +75,7 @@ public:
         }
     }
 
-    SharedPtr(SharedPtr&& other) : cb_(other.cb_), observed_pole_(other.observed_pole_) {
+    SharedPtr(SharedPtr&& other) noexcept : cb_(other.cb_), observed_pole_(other.observed_pole_) {
         // if (other.cb_) {
         //     other.cb_->DecrRef();
         // }
@@ -89,7 +91,8 @@ public:
     }
 
     template <typename U>
-    SharedPtr(SharedPtr<U>&& other) : cb_(other.cb_), observed_pole_(other.observed_pole_) {
+    SharedPtr(SharedPtr<U>&& other) noexcept
+        : cb_(other.cb_), observed_pole_(other.observed_pole_) {
         other.cb_ = nullptr;
         other.observed_pole_ = nullptr;
     }
@@ -103,7 +106,9 @@ public:
 
     template <typename Y>
     SharedPtr(const SharedPtr<Y>& other, T* ptr) : cb_(other.cb_), observed_pole_(ptr) {
-        other.cb_->IncrRef();
+        if (cb_) {
+            cb_->IncrRef();
+        }
     }
 
     // Promote `WeakPtr`
@@ -130,7 +135,7 @@ public:
         return *this;
     }
 
-    SharedPtr& operator=(SharedPtr&& other) {
+    SharedPtr& operator=(SharedPtr&& other) noexcept {
         if (this != &other) {
             if (cb_) {
                 cb_->DecrRef();
@@ -161,7 +166,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Modifiers
 
-    void Reset() {
+    void Reset() noexcept {
         if (cb_) {
             cb_->DecrRef();
             delete cb_;
@@ -193,7 +198,7 @@ public:
         observed_pole_ = ptr;
     }
 
-    void Swap(SharedPtr& other) {
+    void Swap(SharedPtr& other) noexcept {
         std::swap(observed_pole_, other.observed_pole_);
         std::swap(cb_, other.cb_);
     }
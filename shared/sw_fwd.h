@@ -1,5 +1,7 @@
 #pragma once
 
+#include <relocate/relocate.h>
+
 #include <exception>
 
 class BadWeakPtr : public std::exception {};
@@ -9,3 +11,10 @@ class SharedPtr;
 
 template <typename T>
 class WeakPtr;
+
+// Both only hold pointers to the control block and the object
+template <typename T>
+struct IsTriviallyRelocatable<SharedPtr<T>> : std::true_type {};
+
+template <typename T>
+struct IsTriviallyRelocatable<WeakPtr<T>> : std::true_type {};
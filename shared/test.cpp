@@ -5,9 +5,16 @@
 #include "allocations_checker.h"
 
 #include <memory>
+#include <type_traits>
+#include <utility>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static_assert(std::is_nothrow_move_constructible_v<SharedPtr<int>>);
+static_assert(std::is_nothrow_move_assignable_v<SharedPtr<int>>);
+static_assert(noexcept(std::declval<SharedPtr<int>&>().Swap(std::declval<SharedPtr<int>&>())));
+static_assert(noexcept(std::declval<SharedPtr<int>&>().Reset()));
+
 TEST_CASE("Empty") {
     SECTION("Empty state") {
         SharedPtr<int> a, b;
@@ -0,0 +1,33 @@
+# cmake -DCOMPILER=<c++> -DSOURCE=<codegen.cpp> -DINCLUDE_DIR=<repo root> -P check_codegen.cmake
+
+execute_process(
+    COMMAND ${COMPILER} -std=c++20 -O2 -S -o - -DSMART_POINTERS_TRIVIAL_ABI -I${INCLUDE_DIR}
+            ${SOURCE}
+    OUTPUT_VARIABLE assembly
+    ERROR_VARIABLE errors
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Failed to compile ${SOURCE}:\n${errors}")
+endif()
+
+# Instructions of `name`, without labels, directives and comments
+function(function_body name out)
+    string(FIND "${assembly}" "\n${name}:" begin)
+    if(begin EQUAL -1)
+        message(FATAL_ERROR "No ${name} in the assembly")
+    endif()
+    string(SUBSTRING "${assembly}" ${begin} -1 body)
+    string(FIND "${body}" ".cfi_endproc" end)
+    string(SUBSTRING "${body}" 0 ${end} body)
+    string(REGEX MATCHALL "\n\t[a-z][^\n]*" instructions "${body}")
+    string(JOIN "" instructions ${instructions})
+    set(${out} "${instructions}" PARENT_SCOPE)
+endfunction()
+
+function_body(PassRaw raw)
+function_body(PassUnique unique)
+if(NOT raw STREQUAL unique)
+    message(FATAL_ERROR "UniquePtr is not passed like a raw pointer.\n"
+                        "PassRaw:${raw}\nPassUnique:${unique}")
+endif()
+message(STATUS "UniquePtr is passed in a register:${unique}")
@@ -0,0 +1,12 @@
+// Compiled to assembly by check_codegen.cmake: with SMART_POINTERS_TRIVIAL_ABI both functions
+// must compile to the same code, i.e. UniquePtr comes in a register instead of through memory.
+
+#include "unique.h"
+
+extern "C" int* PassRaw(int* ptr) {
+    return ptr;
+}
+
+extern "C" int* PassUnique(UniquePtr<int> ptr) {
+    return ptr.Release();
+}
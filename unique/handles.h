@@ -0,0 +1,97 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cstddef>  // std::nullptr_t
+#include <cstdlib>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Owning handles for resources that are not heap objects: UniquePtr<Fd, FdCloser>,
+// UniquePtr<MappedRegion, Unmapper>. Both are as large as the handle itself.
+
+// File descriptor, -1 means no descriptor
+struct Fd {
+    Fd() = default;
+
+    Fd(std::nullptr_t) {
+    }
+
+    explicit Fd(int value) : fd(value) {
+    }
+
+    explicit operator bool() const {
+        return fd >= 0;
+    }
+
+    bool operator==(const Fd&) const = default;
+
+    bool operator==(std::nullptr_t) const {
+        return fd < 0;
+    }
+
+    int fd = -1;
+};
+
+struct FdCloser {
+    using pointer = Fd;
+
+    void operator()(Fd handle) const {
+        if (handle) {
+            close(handle.fd);
+        }
+    }
+};
+
+// Result of mmap, both the address and the length are needed to unmap it
+struct MappedRegion {
+    MappedRegion() = default;
+
+    MappedRegion(std::nullptr_t) {
+    }
+
+    MappedRegion(void* addr, size_t size) : addr(addr == MAP_FAILED ? nullptr : addr), size(size) {
+    }
+
+    explicit operator bool() const {
+        return addr != nullptr;
+    }
+
+    bool operator==(const MappedRegion&) const = default;
+
+    bool operator==(std::nullptr_t) const {
+        return addr == nullptr;
+    }
+
+    template <typename T = char>
+    T* Data() const {
+        return static_cast<T*>(addr);
+    }
+
+    void* addr = nullptr;
+    size_t size = 0;
+};
+
+struct Unmapper {
+    using pointer = MappedRegion;
+
+    void operator()(MappedRegion region) const {
+        if (region) {
+            munmap(region.addr, region.size);
+        }
+    }
+};
+
+// For memory from malloc/calloc/strdup and C libraries
+struct FreeDelete {
+    void operator()(void* ptr) const {
+        std::free(ptr);
+    }
+};
+
+using UniqueFd = UniquePtr<Fd, FdCloser>;
+using UniqueMapping = UniquePtr<MappedRegion, Unmapper>;
+
+template <typename T>
+using UniqueMalloc = UniquePtr<T, FreeDelete>;
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>  // std::nullptr_t, std::max_align_t
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Owning pointer to a polymorphic `Base` that keeps derived objects of up to `N` bytes in its own
+// storage and only puts larger ones on the heap. Semantics follow UniquePtr. Heap objects, spilled
+// or released, are deleted through `Base*`, so a derived type needs a virtual destructor in `Base`.
+template <typename Base, size_t N = 3 * sizeof(void*)>
+class InlineUniquePtr {
+    struct Ops {
+        void (*destroy)(Base*);
+        // Moves the object into `buffer` and destroys the source
+        Base* (*relocate)(void* buffer, Base*);
+        // Moves the object to the heap and destroys the source
+        Base* (*to_heap)(Base*);
+    };
+
+    template <typename Derived>
+    static constexpr Ops kOps = {
+        [](Base* object) { static_cast<Derived*>(object)->~Derived(); },
+        [](void* buffer, Base* object) -> Base* {
+            auto source = static_cast<Derived*>(object);
+            auto target = new (buffer) Derived(std::move(*source));
+            source->~Derived();
+            return target;
+        },
+        [](Base* object) -> Base* {
+            auto source = static_cast<Derived*>(object);
+            auto target = new Derived(std::move(*source));
+            source->~Derived();
+            return target;
+        }};
+
+public:
+    template <typename Derived>
+    static constexpr bool kFitsInline = sizeof(Derived) <= N &&
+                                        alignof(Derived) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<Derived>;
+
+    InlineUniquePtr() : ptr_(nullptr), ops_(nullptr) {
+    }
+
+    InlineUniquePtr(std::nullptr_t) : ptr_(nullptr), ops_(nullptr) {
+    }
+
+    // Takes ownership of a heap object, which is later released with `delete`
+    explicit InlineUniquePtr(Base* ptr) : ptr_(ptr), ops_(nullptr) {
+    }
+
+    InlineUniquePtr(InlineUniquePtr&& other) noexcept : ptr_(nullptr), ops_(nullptr) {
+        TakeFrom(other);
+    }
+
+    InlineUniquePtr(const InlineUniquePtr&) = delete;
+    InlineUniquePtr& operator=(const InlineUniquePtr&) = delete;
+
+    InlineUniquePtr& operator=(InlineUniquePtr&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            TakeFrom(other);
+        }
+        return *this;
+    }
+
+    InlineUniquePtr& operator=(std::nullptr_t) {
+        Reset();
+        return *this;
+    }
+
+    ~InlineUniquePtr() {
+        Reset();
+    }
+
+    template <typename Derived, typename... Args>
+        requires(std::is_convertible_v<Derived*, Base*> &&
+                 (std::is_same_v<Derived, Base> || std::has_virtual_destructor_v<Base>))
+    Derived& Emplace(Args&&... args) {
+        Reset();
+        Derived* object;
+        if constexpr (kFitsInline<Derived>) {
+            object = new (buffer_) Derived(std::forward<Args>(args)...);
+            ops_ = &kOps<Derived>;
+        } else {
+            object = new Derived(std::forward<Args>(args)...);
+        }
+        ptr_ = object;
+        return *object;
+    }
+
+    // The caller becomes responsible for `delete`; an inline object is moved to the heap first
+    Base* Release() {
+        Base* ptr = ptr_;
+        if (ops_) {
+            ptr = ops_->to_heap(ptr);
+        }
+        ptr_ = nullptr;
+        ops_ = nullptr;
+        return ptr;
+    }
+
+    void Reset(Base* ptr = nullptr) {
+        Base* old_ptr = ptr_;
+        const Ops* old_ops = ops_;
+        ptr_ = ptr;
+        ops_ = nullptr;
+        if (old_ops) {
+            old_ops->destroy(old_ptr);
+        } else if (old_ptr) {
+            delete old_ptr;
+        }
+    }
+
+    void Swap(InlineUniquePtr& other) noexcept {
+        InlineUniquePtr tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    bool IsInline() const {
+        return ops_ != nullptr;
+    }
+
+    Base* Get() const {
+        return ptr_;
+    }
+
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    }
+
+    Base& operator*() const {
+        return *ptr_;
+    }
+
+    Base* operator->() const {
+        return ptr_;
+    }
+
+private:
+    void TakeFrom(InlineUniquePtr& other) {
+        if (other.ops_) {
+            ptr_ = other.ops_->relocate(buffer_, other.ptr_);
+        } else {
+            ptr_ = other.ptr_;
+        }
+        ops_ = other.ops_;
+        other.ptr_ = nullptr;
+        other.ops_ = nullptr;
+    }
+
+    alignas(std::max_align_t) char buffer_[N];
+    Base* ptr_;
+    const Ops* ops_;
+};
+
+template <typename Base, size_t N = 3 * sizeof(void*), typename Derived = Base, typename... Args>
+InlineUniquePtr<Base, N> MakeInlineUnique(Args&&... args) {
+    InlineUniquePtr<Base, N> ptr;
+    ptr.template Emplace<Derived>(std::forward<Args>(args)...);
+    return ptr;
+}
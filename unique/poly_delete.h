@@ -0,0 +1,68 @@
+#pragma once
+
+#include "unique.h"
+
+#include <common/sized_delete.h>
+
+#include <cstddef>
+#include <type_traits>
+
+// Deleter that remembers the concrete type of the object, so that UniquePtr<Base, PolyDelete<Base>>
+// deletes a Derived correctly although Base has no virtual destructor (and no vptr). The type is
+// captured when a non-empty UniquePtr<Derived> with Slug or PolyDelete is converted, together with
+// the offset of the Base subobject measured on that object. Reset with a raw pointer keeps the
+// captured type, so replace the object by assigning a UniquePtr instead.
+template <typename T>
+class PolyDelete {
+    using Object = std::remove_const_t<T>;
+
+public:
+    PolyDelete() = default;
+
+    template <typename U>
+        requires(std::is_convertible_v<U*, T*>)
+    PolyDelete(const Slug<U>&, U* ptr) {
+        if (ptr) {
+            destroy_ = &Destroy<std::remove_const_t<U>>;
+            offset_ = BaseOffset(ptr);
+        }
+    }
+
+    template <typename U>
+        requires(std::is_convertible_v<U*, T*>)
+    PolyDelete(const PolyDelete<U>& other, U* ptr) {
+        if (ptr) {
+            destroy_ = other.destroy_;
+            offset_ = other.offset_ + BaseOffset(ptr);
+        }
+    }
+
+    void operator()(T* ptr) {
+        if (ptr) {
+            destroy_(reinterpret_cast<unsigned char*>(const_cast<Object*>(ptr)) - offset_);
+        }
+    }
+
+private:
+    template <typename U>
+    friend class PolyDelete;
+
+    template <typename U>
+    static void Destroy(void* object) {
+        DeleteSized(static_cast<U*>(object));
+    }
+
+    // Byte offset of the T subobject in `*ptr`
+    template <typename U>
+    static std::ptrdiff_t BaseOffset(U* ptr) {
+        return reinterpret_cast<const unsigned char*>(static_cast<T*>(ptr)) -
+               reinterpret_cast<const unsigned char*>(ptr);
+    }
+
+    // Deletes the complete object, which starts `offset_` bytes before the T subobject
+    void (*destroy_)(void*) = &Destroy<Object>;
+    std::ptrdiff_t offset_ = 0;
+};
+
+template <typename T>
+using PolyUniquePtr = UniquePtr<T, PolyDelete<T>>;
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "unique.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Deleter for arrays that can grow in place: UniquePtr<T[], ReallocArrayDelete<T>>::Reallocate.
+// Trivially relocatable elements are moved by realloc, and arrays of at least kMapThreshold bytes
+// live in their own mapping and grow with mremap, so neither copies nor touches the old pages.
+// Other element types are moved into a new array one by one.
+// The length picks between munmap and free, so these arrays are never adopted without it.
+template <typename T>
+struct ReallocArrayDelete {
+    static_assert(alignof(T) <= alignof(std::max_align_t));
+
+    static constexpr size_t kMapThreshold = 1 << 20;
+    static constexpr bool kNeedsSize = true;
+
+    void operator()(T* ptr, size_t size) {
+        if (ptr) {
+            std::destroy_n(ptr, size);
+            FreeBytes(ptr, size * sizeof(T));
+        }
+    }
+
+    // Elements past `old_size` are default-initialized. If the new block cannot be allocated or an
+    // element cannot be constructed, `ptr` keeps all `old_size` elements.
+    T* Reallocate(T* ptr, size_t old_size, size_t new_size) {
+        if constexpr (kIsTriviallyRelocatable<T>) {
+            if (new_size < old_size) {
+                return Shrink(ptr, old_size, new_size);
+            }
+            if constexpr (std::is_nothrow_default_constructible_v<T>) {
+                auto result =
+                    static_cast<T*>(ResizeBytes(ptr, old_size * sizeof(T), new_size * sizeof(T)));
+                std::uninitialized_default_construct(result + old_size, result + new_size);
+                return result;
+            } else {
+                return GrowWithTail(ptr, old_size, new_size);
+            }
+        } else {
+            static_assert(std::is_nothrow_move_constructible_v<T>);
+            T* result = Allocate(new_size);
+            size_t kept = std::min(old_size, new_size);
+            try {
+                std::uninitialized_default_construct(result + kept, result + new_size);
+            } catch (...) {
+                FreeBytes(result, new_size * sizeof(T));
+                throw;
+            }
+            std::uninitialized_move_n(ptr, kept, result);
+            (*this)(ptr, old_size);
+            return result;
+        }
+    }
+
+    // Raw storage for `size` elements, released with Deallocate
+    static T* Allocate(size_t size) {
+        return static_cast<T*>(AllocateBytes(size * sizeof(T)));
+    }
+
+    static void Deallocate(T* ptr, size_t size) {
+        FreeBytes(ptr, size * sizeof(T));
+    }
+
+private:
+    // Once `ptr` is resized the caller only learns the new block from the return value, so the
+    // elements that may throw are constructed aside first and relocated in afterwards
+    static T* GrowWithTail(T* ptr, size_t old_size, size_t new_size) {
+        size_t added = new_size - old_size;
+        T* tail = Allocate(added);
+        try {
+            std::uninitialized_default_construct_n(tail, added);
+        } catch (...) {
+            Deallocate(tail, added);
+            throw;
+        }
+        T* result;
+        try {
+            result = static_cast<T*>(ResizeBytes(ptr, old_size * sizeof(T), new_size * sizeof(T)));
+        } catch (...) {
+            std::destroy_n(tail, added);
+            Deallocate(tail, added);
+            throw;
+        }
+        if (added) {
+            std::memcpy(static_cast<void*>(result + old_size), tail, added * sizeof(T));
+        }
+        Deallocate(tail, added);
+        return result;
+    }
+
+    // The tail is destroyed only after the only step that can fail, allocating a block on the
+    // other side of kMapThreshold
+    static T* Shrink(T* ptr, size_t old_size, size_t new_size) {
+        size_t old_bytes = old_size * sizeof(T);
+        size_t new_bytes = new_size * sizeof(T);
+        if (new_size == 0 || IsMapped(old_bytes) != IsMapped(new_bytes)) {
+            T* result = Allocate(new_size);
+            std::destroy(ptr + new_size, ptr + old_size);
+            if (result) {
+                std::memcpy(static_cast<void*>(result), ptr, new_bytes);
+            }
+            FreeBytes(ptr, old_bytes);
+            return result;
+        }
+        std::destroy(ptr + new_size, ptr + old_size);
+        return static_cast<T*>(ShrinkBytes(ptr, old_bytes, new_bytes));
+    }
+
+    static bool IsMapped(size_t bytes) {
+#ifdef __linux__
+        return bytes >= kMapThreshold;
+#else
+        (void)bytes;
+        return false;
+#endif
+    }
+
+    static void* AllocateBytes(size_t bytes) {
+        if (bytes == 0) {
+            return nullptr;
+        }
+        void* ptr;
+#ifdef __linux__
+        if (IsMapped(bytes)) {
+            ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            return ptr;
+        }
+#endif
+        ptr = std::malloc(bytes);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    static void FreeBytes(void* ptr, size_t bytes) {
+        if (!ptr) {
+            return;
+        }
+#ifdef __linux__
+        if (IsMapped(bytes)) {
+            munmap(ptr, bytes);
+            return;
+        }
+#endif
+        std::free(ptr);
+    }
+
+    // Both sizes are on the same side of kMapThreshold; cannot fail
+    static void* ShrinkBytes(void* ptr, size_t old_bytes, size_t new_bytes) {
+#ifdef __linux__
+        if (IsMapped(old_bytes)) {
+            size_t page = sysconf(_SC_PAGESIZE);
+            size_t kept = (new_bytes + page - 1) / page * page;
+            if (kept < old_bytes) {
+                munmap(static_cast<char*>(ptr) + kept, old_bytes - kept);
+            }
+            return ptr;
+        }
+#endif
+        // A failed shrink leaves the larger block, which is still freed with std::free
+        void* result = std::realloc(ptr, new_bytes);
+        return result ? result : ptr;
+    }
+
+    static void* ResizeBytes(void* ptr, size_t old_bytes, size_t new_bytes) {
+        if (!ptr || new_bytes == 0 || IsMapped(old_bytes) != IsMapped(new_bytes)) {
+            void* result = AllocateBytes(new_bytes);
+            if (ptr && result) {
+                std::memcpy(result, ptr, std::min(old_bytes, new_bytes));
+            }
+            FreeBytes(ptr, old_bytes);
+            return result;
+        }
+#ifdef __linux__
+        if (IsMapped(old_bytes)) {
+            void* result = mremap(ptr, old_bytes, new_bytes, MREMAP_MAYMOVE);
+            if (result == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            return result;
+        }
+#endif
+        void* result = std::realloc(ptr, new_bytes);
+        if (!result) {
+            throw std::bad_alloc();
+        }
+        return result;
+    }
+};
+
+// Value-initialized array that can later grow with Reallocate
+template <typename T>
+    requires(std::is_unbounded_array_v<T>)
+UniquePtr<T, ReallocArrayDelete<std::remove_extent_t<T>>> MakeUniqueGrowable(size_t size) {
+    using Elem = std::remove_extent_t<T>;
+    Elem* ptr = ReallocArrayDelete<Elem>::Allocate(size);
+    try {
+        std::uninitialized_value_construct_n(ptr, size);
+    } catch (...) {
+        ReallocArrayDelete<Elem>::Deallocate(ptr, size);
+        throw;
+    }
+    return {ptr, size, ReallocArrayDelete<Elem>()};
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cstddef>  // std::nullptr_t
+#include <cstdint>
+
+// Pointer that carries a small tag (e.g. the id of the pool the object came from) in bits the
+// address does not use: the low alignment bits when there are enough of them, the top bits of a
+// 64-bit address otherwise. A deleter with `using pointer = TaggedPointer<T, Bits>` keeps its
+// state in the tag, so the deleter itself is empty and UniquePtr stays one word.
+template <typename T, size_t Bits>
+class TaggedPointer {
+    static constexpr size_t kAlignBits = std::countr_zero(alignof(T));
+    static constexpr bool kLowBits = Bits <= kAlignBits;
+
+    static_assert(kLowBits || (sizeof(uintptr_t) == 8 && Bits <= 16), "no room for the tag");
+
+    static constexpr size_t kShift = kLowBits ? 0 : 64 - Bits;
+
+public:
+    static constexpr uintptr_t kMaxTag = (uintptr_t(1) << Bits) - 1;
+
+    TaggedPointer() = default;
+
+    TaggedPointer(std::nullptr_t) {
+    }
+
+    TaggedPointer(T* ptr, uintptr_t tag = 0)
+        : bits_(reinterpret_cast<uintptr_t>(ptr) | (tag << kShift)) {
+        assert(tag <= kMaxTag);
+        assert(Get() == ptr && "address uses the tag bits");
+    }
+
+    T* Get() const {
+        return reinterpret_cast<T*>(bits_ & ~(kMaxTag << kShift));
+    }
+
+    uintptr_t Tag() const {
+        return (bits_ >> kShift) & kMaxTag;
+    }
+
+    T* operator->() const {
+        return Get();
+    }
+
+    T& operator*() const {
+        return *Get();
+    }
+
+    explicit operator bool() const {
+        return Get() != nullptr;
+    }
+
+    bool operator==(const TaggedPointer&) const = default;
+
+    bool operator==(std::nullptr_t) const {
+        return Get() == nullptr;
+    }
+
+private:
+    uintptr_t bits_ = 0;
+};
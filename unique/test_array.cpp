@@ -0,0 +1,143 @@
+#include "unique.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <new>
+#include <numeric>
+#include <span>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int Sum(std::span<const int> values) {
+    return std::accumulate(values.begin(), values.end(), 0);
+}
+
+TEST_CASE("Arrays with length") {
+    SECTION("MakeUniqueAligned") {
+        auto u = MakeUniqueAligned<float[]>(1000, 64);
+        REQUIRE(u.Size() == 1000);
+        REQUIRE(reinterpret_cast<uintptr_t>(u.Get()) % 64 == 0);
+        for (float value : u) {
+            REQUIRE(value == 0.0f);
+        }
+    }
+
+    SECTION("Large alignment") {
+        auto u = MakeUniqueAligned<double[]>(3, 4096);
+        REQUIRE(reinterpret_cast<uintptr_t>(u.Get()) % 4096 == 0);
+    }
+
+    SECTION("Too long") {
+        REQUIRE_THROWS_AS(MakeUniqueAligned<double[]>(SIZE_MAX / 4), std::bad_array_new_length);
+    }
+
+    SECTION("Default deleter") {
+        UniquePtr<float[], AlignedArrayDelete<float>> u;
+        REQUIRE(u.GetDeleter().align == std::align_val_t(alignof(float)));
+        u = MakeUniqueAligned<float[]>(8, alignof(float));
+        REQUIRE(u.Size() == 8);
+    }
+
+    SECTION("Elements are destroyed") {
+        {
+            auto u = MakeUniqueAligned<MyInt[]>(10);
+            REQUIRE(MyInt::AliveCount() == 10);
+            u.Reset();
+            REQUIRE(MyInt::AliveCount() == 0);
+            REQUIRE(u.Size() == 0);
+        }
+        { auto u = MakeUniqueAligned<MyInt[]>(5); }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("MakeUniqueForOverwrite") {
+        auto u = MakeUniqueForOverwrite<int[]>(10);
+        REQUIRE(u.Size() == 10);
+        std::iota(u.begin(), u.end(), 1);
+        REQUIRE(Sum(u) == 55);
+        REQUIRE(u[9] == 10);
+    }
+
+    SECTION("Move and swap keep the length") {
+        auto a = MakeUniqueForOverwrite<int[]>(4);
+        auto b = std::move(a);
+        REQUIRE(a.Size() == 0);
+        REQUIRE(b.Size() == 4);
+
+        UniquePtr<int[]> c;
+        c.Swap(b);
+        REQUIRE(c.Size() == 4);
+        REQUIRE(b.Size() == 0);
+
+        int* raw = c.Release();
+        REQUIRE(c.Size() == 0);
+        delete[] raw;
+    }
+
+    SECTION("Raw pointers have unknown length") {
+        UniquePtr<int[]> u(new int[3]);
+        REQUIRE(u.Size() == 0);
+        REQUIRE(std::span<int>(u).empty());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct PooledCell {
+    static int deletes;
+
+    static void* operator new(size_t size) {
+        return ::operator new(size);
+    }
+
+    static void operator delete(void* ptr) {
+        ++deletes;
+        ::operator delete(ptr);
+    }
+
+    int value = 0;
+};
+
+int PooledCell::deletes = 0;
+
+struct SizedCell {
+    static size_t deleted_size;
+
+    static void operator delete(void* ptr, size_t size) {
+        deleted_size = size;
+        ::operator delete(ptr);
+    }
+
+    static void operator delete[](void* ptr, size_t size) {
+        deleted_size = size;
+        ::operator delete[](ptr);
+    }
+
+    int value = 0;
+};
+
+size_t SizedCell::deleted_size = 0;
+
+TEST_CASE("Sized delete") {
+    SECTION("Own sized operator delete gets the size") {
+        SizedCell::deleted_size = 0;
+        { UniquePtr<SizedCell> cell(new SizedCell); }
+        REQUIRE(SizedCell::deleted_size == sizeof(SizedCell));
+    }
+
+    SECTION("Arrays of known length keep own sized operator delete[]") {
+        SizedCell::deleted_size = 0;
+        { auto cells = MakeUniqueForOverwrite<SizedCell[]>(5); }
+        REQUIRE(SizedCell::deleted_size >= 5 * sizeof(SizedCell));
+    }
+
+    SECTION("Own operator delete is kept") {
+        PooledCell::deletes = 0;
+        { UniquePtr<PooledCell> cell(new PooledCell); }
+        REQUIRE(PooledCell::deletes == 1);
+    }
+}
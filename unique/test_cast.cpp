@@ -0,0 +1,58 @@
+#include "unique.h"
+
+#include <catch.hpp>
+
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Message {
+    virtual ~Message() = default;
+};
+
+struct TextMessage : Message {
+    std::string text = "hello";
+};
+
+struct EmptyMessage : Message {};
+
+struct CountingDelete {
+    void operator()(Message* message) {
+        if (message) {
+            ++*deleted;
+            delete message;
+        }
+    }
+
+    int* deleted = nullptr;
+};
+
+TEST_CASE("DynamicPointerCast for UniquePtr") {
+    SECTION("Success moves ownership") {
+        UniquePtr<Message> message(new TextMessage);
+        for (int i = 0; i < 2; ++i) {
+            UniquePtr<TextMessage> text = DynamicPointerCast<TextMessage>(std::move(message));
+            REQUIRE(!message);
+            REQUIRE(text->text == "hello");
+            message = std::move(text);
+        }
+    }
+
+    SECTION("Failure keeps the source") {
+        UniquePtr<Message> message(new EmptyMessage);
+        auto text = DynamicPointerCast<TextMessage>(std::move(message));
+        REQUIRE(!text);
+        REQUIRE(message);
+    }
+
+    SECTION("Custom deleter is moved over") {
+        int deleted = 0;
+        {
+            UniquePtr<Message, CountingDelete> message(new TextMessage, CountingDelete{&deleted});
+            auto text = DynamicPointerCast<TextMessage>(std::move(message));
+            static_assert(std::is_same_v<decltype(text), UniquePtr<TextMessage, CountingDelete>>);
+            REQUIRE(text->text == "hello");
+        }
+        REQUIRE(deleted == 1);
+    }
+}
@@ -0,0 +1,70 @@
+#include "unique.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <stdexcept>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Reading {
+    Reading(int value, bool fail = false) : value(value) {
+        if (fail) {
+            throw std::runtime_error("reading");
+        }
+    }
+
+    int value;
+    std::string unit = "ms";
+};
+
+struct Sensor {
+    virtual ~Sensor() = default;
+};
+
+struct Thermometer : Sensor {
+    int degrees = 20;
+};
+
+struct alignas(64) WideReading {
+    WideReading(int value) : value(value) {
+    }
+
+    int value;
+};
+
+TEST_CASE("UniquePtr Emplace") {
+    SECTION("Reuses the allocation") {
+        UniquePtr<Reading> ptr(new Reading(1));
+        Reading* object = ptr.Get();
+        EXPECT_ZERO_ALLOCATIONS(for (int i = 2; i < 100; ++i) { ptr.Emplace(i); });
+        REQUIRE(ptr.Get() == object);
+        REQUIRE(ptr->value == 99);
+    }
+
+    SECTION("Empty pointer allocates") {
+        UniquePtr<Reading> ptr;
+        REQUIRE(ptr.Emplace(7).value == 7);
+        REQUIRE(ptr->value == 7);
+    }
+
+    SECTION("Derived objects are not reused") {
+        UniquePtr<Sensor> ptr(new Thermometer);
+        Sensor& sensor = ptr.Emplace();
+        REQUIRE(typeid(sensor) == typeid(Sensor));
+    }
+
+    SECTION("Over-aligned objects") {
+        UniquePtr<WideReading> ptr(new WideReading(1));
+        ptr.Emplace(2);
+        REQUIRE(ptr->value == 2);
+    }
+
+    SECTION("A throwing constructor leaves the pointer empty") {
+        UniquePtr<Reading> ptr(new Reading(1));
+        REQUIRE_THROWS_AS(ptr.Emplace(2, true), std::runtime_error);
+        REQUIRE(!ptr);
+    }
+}
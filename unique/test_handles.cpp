@@ -0,0 +1,82 @@
+#include "handles.h"
+
+#include <catch.hpp>
+
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool IsOpen(int fd) {
+    return fcntl(fd, F_GETFD) != -1;
+}
+
+TEST_CASE("Non-pointer handles") {
+    SECTION("Handles take no extra space") {
+        static_assert(sizeof(UniqueFd) == sizeof(int));
+        static_assert(sizeof(UniqueMapping) == sizeof(MappedRegion));
+        static_assert(sizeof(UniqueMalloc<char>) == sizeof(char*));
+        static_assert(std::is_same_v<UniqueFd::Pointer, Fd>);
+        static_assert(std::is_same_v<UniquePtr<int>::Pointer, int*>);
+    }
+
+    SECTION("File descriptors are closed") {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        {
+            UniqueFd read_end{Fd(fds[0])};
+            UniqueFd write_end{Fd(fds[1])};
+            REQUIRE(read_end);
+            REQUIRE(read_end.Get().fd == fds[0]);
+
+            UniqueFd moved = std::move(write_end);
+            REQUIRE(!write_end);
+            REQUIRE(IsOpen(fds[1]));
+            moved.Reset();
+            REQUIRE(!IsOpen(fds[1]));
+            REQUIRE(IsOpen(fds[0]));
+        }
+        REQUIRE(!IsOpen(fds[0]));
+    }
+
+    SECTION("Release gives the descriptor back") {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        UniqueFd read_end{Fd(fds[0])};
+        Fd raw = read_end.Release();
+        REQUIRE(!read_end);
+        REQUIRE(raw.fd == fds[0]);
+        read_end.Reset(raw);
+        close(fds[1]);
+    }
+
+    SECTION("Mappings are unmapped") {
+        size_t size = sysconf(_SC_PAGESIZE);
+        UniqueMapping mapping(MappedRegion(
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0),
+            size));
+        REQUIRE(mapping);
+        std::memset(mapping.Get().Data(), 1, size);
+        REQUIRE(mapping.Get().Data()[size - 1] == 1);
+        mapping = nullptr;
+        REQUIRE(!mapping);
+    }
+
+    SECTION("Failed mmap gives an empty handle") {
+        MappedRegion region(MAP_FAILED, 0);
+        REQUIRE(region == nullptr);
+        UniqueMapping mapping(region);
+        REQUIRE(!mapping);
+    }
+
+    SECTION("malloc memory") {
+        UniqueMalloc<char> str(strdup("handle"));
+        REQUIRE(std::strcmp(str.Get(), "handle") == 0);
+        UniqueMalloc<int> values(static_cast<int*>(std::calloc(4, sizeof(int))));
+        REQUIRE(*values == 0);
+    }
+}
@@ -0,0 +1,148 @@
+#include "inline_unique.h"
+#include "unique.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Strategy {
+    static int alive;
+
+    Strategy() {
+        ++alive;
+    }
+
+    Strategy(const Strategy&) {
+        ++alive;
+    }
+
+    virtual ~Strategy() {
+        --alive;
+    }
+
+    virtual int Apply(int x) const = 0;
+};
+
+int Strategy::alive = 0;
+
+struct AddStrategy : Strategy {
+    AddStrategy(int delta) : delta(delta) {
+    }
+
+    AddStrategy(AddStrategy&& other) noexcept : Strategy(other), delta(other.delta) {
+    }
+
+    int Apply(int x) const override {
+        return x + delta;
+    }
+
+    int delta;
+};
+
+struct BigStrategy : Strategy {
+    BigStrategy(int value) {
+        table[0] = value;
+    }
+
+    int Apply(int) const override {
+        return table[0];
+    }
+
+    int table[64];
+};
+
+struct PlainBase {
+    int value = 0;
+};
+
+struct PlainDerived : PlainBase {
+    int extra = 0;
+};
+
+template <typename Derived, typename Base>
+constexpr bool kCanEmplace = requires(InlineUniquePtr<Base>& p) { p.template Emplace<Derived>(); };
+
+// Whether a derived object fits inline or not, it could end up deleted through `Base*`
+static_assert(kCanEmplace<AddStrategy, Strategy>);
+static_assert(kCanEmplace<PlainBase, PlainBase>);
+static_assert(!kCanEmplace<PlainDerived, PlainBase>);
+
+TEST_CASE("InlineUniquePtr") {
+    SECTION("Small objects are stored inline") {
+        auto p = MakeInlineUnique<Strategy, 32, AddStrategy>(5);
+        REQUIRE(p.IsInline());
+        REQUIRE(p->Apply(1) == 6);
+        REQUIRE(Strategy::alive == 1);
+        p.Reset();
+        REQUIRE(!p);
+        REQUIRE(Strategy::alive == 0);
+    }
+
+    SECTION("Large objects spill to the heap") {
+        auto p = MakeInlineUnique<Strategy, 32, BigStrategy>(7);
+        REQUIRE(!p.IsInline());
+        REQUIRE(p->Apply(0) == 7);
+    }
+
+    SECTION("Move relocates inline objects") {
+        auto a = MakeInlineUnique<Strategy, 32, AddStrategy>(1);
+        InlineUniquePtr<Strategy, 32> b = std::move(a);
+        REQUIRE(!a);
+        REQUIRE(b.IsInline());
+        REQUIRE(b->Apply(1) == 2);
+        REQUIRE(Strategy::alive == 1);
+
+        auto c = MakeInlineUnique<Strategy, 32, BigStrategy>(3);
+        c = std::move(b);
+        REQUIRE(c->Apply(1) == 2);
+        REQUIRE(Strategy::alive == 1);
+    }
+
+    SECTION("Swap") {
+        auto a = MakeInlineUnique<Strategy, 32, AddStrategy>(1);
+        auto b = MakeInlineUnique<Strategy, 32, BigStrategy>(9);
+        a.Swap(b);
+        REQUIRE(a->Apply(0) == 9);
+        REQUIRE(b->Apply(0) == 1);
+        REQUIRE(Strategy::alive == 2);
+    }
+
+    SECTION("Release moves to the heap") {
+        auto p = MakeInlineUnique<Strategy, 32, AddStrategy>(2);
+        Strategy* raw = p.Release();
+        REQUIRE(!p);
+        REQUIRE(raw->Apply(2) == 4);
+        REQUIRE(Strategy::alive == 1);
+        UniquePtr<Strategy> owner(raw);
+    }
+
+    SECTION("Raw pointer") {
+        InlineUniquePtr<Strategy> p(new AddStrategy(3));
+        REQUIRE(!p.IsInline());
+        p.Reset(new AddStrategy(4));
+        REQUIRE(p->Apply(0) == 4);
+        REQUIRE(Strategy::alive == 1);
+    }
+
+    REQUIRE(Strategy::alive == 0);
+}
+
+TEST_CASE("InlineUniquePtr allocations") {
+    SECTION("UniquePtr allocates every strategy") {
+        EXPECT_ONE_ALLOCATION(UniquePtr<Strategy> p(new AddStrategy(1)));
+    }
+
+    SECTION("InlineUniquePtr does not") {
+        std::vector<InlineUniquePtr<Strategy, 32>> strategies;
+        strategies.reserve(1000);
+        EXPECT_ZERO_ALLOCATIONS(for (int i = 0; i < 1000; ++i) {
+            strategies.push_back(MakeInlineUnique<Strategy, 32, AddStrategy>(i));
+        });
+        REQUIRE(strategies[999]->Apply(1) == 1000);
+    }
+}
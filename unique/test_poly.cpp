@@ -0,0 +1,114 @@
+#include "poly_delete.h"
+
+#include <catch.hpp>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Plain data, no vptr anywhere
+struct Event {
+    int kind = 0;
+};
+
+struct KeyEvent : Event {
+    static int alive;
+
+    explicit KeyEvent(std::string key) : key(std::move(key)) {
+        ++alive;
+    }
+
+    ~KeyEvent() {
+        --alive;
+    }
+
+    std::string key;
+};
+
+int KeyEvent::alive = 0;
+
+struct Timestamp {
+    long long nanos = 0;
+};
+
+// Event is not the first base, so its address differs from the object's
+struct ClickEvent : Timestamp, Event {
+    std::vector<int> buttons = std::vector<int>(10);
+};
+
+struct DoubleClickEvent : std::string, ClickEvent {
+    int interval = 0;
+};
+
+// The offset of a virtual base depends on the complete object
+struct SharedEvent : virtual Event {
+    std::string source = std::string(100, 's');
+};
+
+struct RelayedEvent : Timestamp, SharedEvent {};
+
+static_assert(!std::is_polymorphic_v<Event>);
+static_assert(!std::has_virtual_destructor_v<Event>);
+
+TEST_CASE("PolyDelete") {
+    SECTION("Derived object through a base without a virtual destructor") {
+        {
+            PolyUniquePtr<Event> event = UniquePtr<KeyEvent>(new KeyEvent("long enough to spill"));
+            REQUIRE(KeyEvent::alive == 1);
+        }
+        REQUIRE(KeyEvent::alive == 0);
+    }
+
+    SECTION("Base at an offset") {
+        auto click = new ClickEvent;
+        PolyUniquePtr<Event> event = UniquePtr<ClickEvent>(click);
+        REQUIRE(static_cast<void*>(event.Get()) != static_cast<void*>(click));
+    }
+
+    SECTION("Conversions are chained") {
+        PolyUniquePtr<ClickEvent> click = UniquePtr<DoubleClickEvent>(new DoubleClickEvent);
+        PolyUniquePtr<Timestamp> first = PolyUniquePtr<ClickEvent>(new ClickEvent);
+        PolyUniquePtr<Event> event(std::move(click));
+        REQUIRE(!click);
+        REQUIRE(event);
+    }
+
+    SECTION("Virtual base") {
+        auto relayed = new RelayedEvent;
+        PolyUniquePtr<Event> event = UniquePtr<RelayedEvent>(relayed);
+        REQUIRE(event.Get() == static_cast<Event*>(relayed));
+        event = UniquePtr<SharedEvent>(new SharedEvent);
+    }
+
+    SECTION("Empty pointers") {
+        PolyUniquePtr<Event> event = UniquePtr<ClickEvent>();
+        REQUIRE(!event);
+        event.Reset(new Event);
+    }
+
+    SECTION("Mixed objects in one container") {
+        std::vector<PolyUniquePtr<Event>> events;
+        events.emplace_back(UniquePtr<KeyEvent>(new KeyEvent("k")));
+        events.emplace_back(UniquePtr<ClickEvent>(new ClickEvent));
+        events.emplace_back(UniquePtr<DoubleClickEvent>(new DoubleClickEvent));
+        events.emplace_back(new Event);
+        events.erase(events.begin());
+        REQUIRE(KeyEvent::alive == 0);
+    }
+
+    SECTION("Assignment replaces the captured type") {
+        PolyUniquePtr<Event> event = UniquePtr<KeyEvent>(new KeyEvent("k"));
+        event = UniquePtr<ClickEvent>(new ClickEvent);
+        REQUIRE(KeyEvent::alive == 0);
+        event = nullptr;
+    }
+
+    SECTION("Const objects") {
+        PolyUniquePtr<const Event> event = UniquePtr<const KeyEvent>(new KeyEvent("k"));
+        REQUIRE(KeyEvent::alive == 1);
+        event.Reset();
+        REQUIRE(KeyEvent::alive == 0);
+    }
+}
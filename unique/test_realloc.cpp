@@ -0,0 +1,147 @@
+#include "realloc_array.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Trivially relocatable, but its construction can fail
+struct Fragile {
+    static int budget;
+
+    Fragile() {
+        if (budget-- == 0) {
+            throw std::runtime_error("out of budget");
+        }
+    }
+
+    int value = 7;
+};
+
+int Fragile::budget = -1;
+
+TEST_CASE("Growable arrays") {
+    SECTION("Trivial elements keep their values") {
+        auto u = MakeUniqueGrowable<int[]>(10);
+        REQUIRE(u.Size() == 10);
+        REQUIRE(u[9] == 0);
+        std::iota(u.begin(), u.end(), 0);
+
+        u.Reallocate(1000);
+        REQUIRE(u.Size() == 1000);
+        for (int i = 0; i < 10; ++i) {
+            REQUIRE(u[i] == i);
+        }
+
+        u.Reallocate(5);
+        REQUIRE(u.Size() == 5);
+        REQUIRE(u[4] == 4);
+    }
+
+    SECTION("Large arrays are remapped") {
+        using Delete = ReallocArrayDelete<uint64_t>;
+        size_t size = 2 * Delete::kMapThreshold / sizeof(uint64_t);
+        auto u = MakeUniqueGrowable<uint64_t[]>(10);
+        u[0] = 1;
+
+        u.Reallocate(size);
+        u[size - 1] = 2;
+        u.Reallocate(4 * size);
+        REQUIRE(u[0] == 1);
+        REQUIRE(u[size - 1] == 2);
+        u[4 * size - 1] = 3;
+
+        u.Reallocate(10);
+        REQUIRE(u[0] == 1);
+    }
+
+    SECTION("Other elements are moved") {
+        auto u = MakeUniqueGrowable<std::string[]>(3);
+        u[0] = "first";
+        u[2] = std::string(100, 'x');
+
+        u.Reallocate(100);
+        REQUIRE(u[0] == "first");
+        REQUIRE(u[2] == std::string(100, 'x'));
+        REQUIRE(u[99].empty());
+
+        u.Reallocate(1);
+        REQUIRE(u.Size() == 1);
+        REQUIRE(u[0] == "first");
+    }
+
+    SECTION("Relocatable elements are not moved one by one") {
+        auto u = MakeUniqueGrowable<UniquePtr<int>[]>(2);
+        u[1].Reset(new int(5));
+        u.Reallocate(1000);
+        REQUIRE(*u[1] == 5);
+        REQUIRE(!u[999]);
+        u.Reallocate(1);
+        REQUIRE(!u[0]);
+    }
+
+    SECTION("Failed growth keeps the array") {
+        static_assert(kIsTriviallyRelocatable<Fragile>);
+        auto u = MakeUniqueGrowable<Fragile[]>(3);
+        u[2].value = 9;
+        Fragile::budget = 10;
+        REQUIRE_THROWS_AS(u.Reallocate(100), std::runtime_error);
+        REQUIRE(u.Size() == 3);
+        REQUIRE(u[2].value == 9);
+
+        Fragile::budget = -1;
+        u.Reallocate(100);
+        REQUIRE(u[2].value == 9);
+        REQUIRE(u[99].value == 7);
+    }
+
+    SECTION("Empty arrays") {
+        UniquePtr<double[], ReallocArrayDelete<double>> u;
+        u.Reallocate(3);
+        REQUIRE(u.Size() == 3);
+        u[2] = 1.5;
+        u.Reallocate(0);
+        REQUIRE(!u);
+        REQUIRE(u.Size() == 0);
+    }
+
+    SECTION("Large arrays are adopted only with their length") {
+        using Growable = UniquePtr<char[], ReallocArrayDelete<char>>;
+        static_assert(!std::is_constructible_v<Growable, char*>);
+        static_assert(!std::is_constructible_v<Growable, char*, ReallocArrayDelete<char>>);
+
+        size_t size = 2 * ReallocArrayDelete<char>::kMapThreshold;
+        auto u = MakeUniqueGrowable<char[]>(size);
+        u[size - 1] = 'x';
+        char* raw = u.Release();
+
+        Growable v(raw, size, ReallocArrayDelete<char>());
+        REQUIRE(v[size - 1] == 'x');
+        auto w = std::move(v);
+        REQUIRE(w.Size() == size);
+
+        Growable x;
+        x.Reset(w.Release(), size);
+        REQUIRE(x.Size() == size);
+        x.Reset();
+        REQUIRE(!x);
+    }
+
+    SECTION("Shrinking below the map threshold") {
+        size_t size = 2 * ReallocArrayDelete<int>::kMapThreshold / sizeof(int);
+        auto u = MakeUniqueGrowable<UniquePtr<int>[]>(size);
+        u[0].Reset(new int(1));
+        u[size - 1].Reset(new int(2));
+        u.Reallocate(size / 2 + 1);
+        REQUIRE(*u[0] == 1);
+        u.Reallocate(1);
+        REQUIRE(*u[0] == 1);
+        u.Reallocate(size);
+        REQUIRE(!u[size - 1]);
+    }
+}
@@ -0,0 +1,87 @@
+#include "tagged_pointer.h"
+#include "unique.h"
+
+#include <catch.hpp>
+
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Node {
+    int value;
+};
+
+struct Pools {
+    static inline int released[8] = {};
+};
+
+// Returns the object to one of eight pools, the pool id travels in the pointer
+struct PoolDeleter {
+    using pointer = TaggedPointer<Node, 3>;
+
+    void operator()(pointer ptr) const {
+        if (ptr) {
+            ++Pools::released[ptr.Tag()];
+            delete ptr.Get();
+        }
+    }
+};
+
+struct Byte {
+    char value;
+};
+
+TEST_CASE("Deleter state in the pointer") {
+    using PoolPtr = UniquePtr<Node, PoolDeleter>;
+    static_assert(sizeof(PoolPtr) == sizeof(void*));
+    static_assert(sizeof(TaggedPointer<Byte, 4>) == sizeof(void*));
+
+    SECTION("Tag selects the pool") {
+        {
+            PoolPtr a({new Node{1}, 5});
+            PoolPtr b({new Node{2}, 7});
+            REQUIRE(a->value == 1);
+            REQUIRE((*b).value == 2);
+            REQUIRE(a.Get().Tag() == 5);
+
+            a.Swap(b);
+            REQUIRE(a->value == 2);
+            REQUIRE(a.Get().Tag() == 7);
+        }
+        REQUIRE(Pools::released[5] == 1);
+        REQUIRE(Pools::released[7] == 1);
+    }
+
+    SECTION("Null with a tag is still null") {
+        PoolPtr ptr({nullptr, 3});
+        REQUIRE(!ptr);
+        PoolPtr empty;
+        REQUIRE(!empty);
+    }
+
+    SECTION("Release and Reset") {
+        PoolPtr ptr({new Node{3}, 1});
+        auto raw = ptr.Release();
+        REQUIRE(!ptr);
+        REQUIRE(raw.Tag() == 1);
+        ptr.Reset(raw);
+        REQUIRE(ptr->value == 3);
+    }
+
+    SECTION("Unaligned types use the top bits") {
+        Byte byte{42};
+        TaggedPointer<Byte, 4> ptr(&byte, 9);
+        REQUIRE(ptr.Get() == &byte);
+        REQUIRE(ptr.Tag() == 9);
+        REQUIRE(ptr->value == 42);
+    }
+
+    SECTION("Containers stay dense") {
+        std::vector<PoolPtr> nodes;
+        for (int i = 0; i < 16; ++i) {
+            nodes.emplace_back(PoolDeleter::pointer(new Node{i}, i % 8));
+        }
+        REQUIRE(nodes[9]->value == 9);
+        REQUIRE(nodes[9].Get().Tag() == 1);
+    }
+}
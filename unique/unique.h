@@ -2,8 +2,23 @@
 
 #include "compressed_pair.h"
 
+#include <common/cached_cast.h>
+#include <common/sized_delete.h>
+#include <common/trivial_abi.h>
+#include <relocate/relocate.h>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
 #include <cstddef>  // std::nullptr_t
+#include <memory>   // std::destroy_n, std::to_address, std::uninitialized_value_construct_n
+#include <new>
+#include <span>
 #include <type_traits>
+#include <typeinfo>
+#include <utility>
 
 template <typename T>
 struct Slug {
@@ -21,7 +36,7 @@ struct Slug {
 
     void operator()(T* ptr) {
         if (ptr) {
-            delete ptr;
+            DeleteSized(ptr);
         }
     }
 };
@@ -45,16 +60,51 @@ struct Slug<T[]> {
             delete[] ptr;
         }
     }
+
+    // `size` is the length the array was allocated with, 0 if unknown
+    void operator()(T* ptr, size_t size) {
+        if (ptr) {
+            DeleteArraySized(ptr, size);
+        }
+    }
+};
+
+// `Deleter::pointer` if the deleter declares it (e.g. a file descriptor or a mapped region),
+// `T*` otherwise, as in std::unique_ptr
+template <typename T, typename Deleter>
+struct UniquePointer {
+    using Type = T*;
+};
+
+template <typename T, typename Deleter>
+    requires requires { typename std::remove_reference_t<Deleter>::pointer; }
+struct UniquePointer<T, Deleter> {
+    using Type = typename std::remove_reference_t<Deleter>::pointer;
 };
 
+// Deleter for a converted UniquePtr. Deleters that depend on the object (see PolyDelete) are
+// constructed from the old deleter and the pointer being converted.
+template <typename Deleter, typename OtherDeleter, typename U>
+Deleter ConvertDeleter(OtherDeleter&& deleter, U* ptr) {
+    if constexpr (std::is_constructible_v<Deleter, OtherDeleter, U*>) {
+        return Deleter(std::forward<OtherDeleter>(deleter), ptr);
+    } else {
+        return Deleter(std::forward<OtherDeleter>(deleter));
+    }
+}
+
 // Primary template
 template <typename T, typename Deleter = Slug<T>>
-class UniquePtr {
+class TRIVIAL_ABI UniquePtr {
 public:
-    explicit UniquePtr(T* ptr = nullptr) : data_(ptr, Deleter()) {
+    using Pointer = typename UniquePointer<T, Deleter>::Type;
+
+    explicit UniquePtr(Pointer ptr = Pointer())
+        noexcept(std::is_nothrow_default_constructible_v<Deleter>)
+        : data_(ptr, Deleter()) {
     }
 
-    UniquePtr(T* ptr, Deleter deleter) : data_(ptr, std::move(deleter)) {
+    UniquePtr(Pointer ptr, Deleter deleter) : data_(ptr, std::move(deleter)) {
     }
 
     UniquePtr(UniquePtr&& other) noexcept {
@@ -62,9 +112,12 @@ public:
     }
 
     template <typename U = T, typename OtherDeleter = Deleter>
-        requires(std::is_convertible_v<U*, T*> && std::is_convertible_v<OtherDeleter, Deleter>)
+        requires(std::is_convertible_v<U*, T*> &&
+                 (std::is_convertible_v<OtherDeleter, Deleter> ||
+                  std::is_constructible_v<Deleter, OtherDeleter, U*>))
     UniquePtr(UniquePtr<U, OtherDeleter>&& other) noexcept
-        : data_(other.Release(), std::move(other.GetDeleter())) {
+        : data_(other.Get(), ConvertDeleter<Deleter>(std::move(other.GetDeleter()), other.Get())) {
+        other.Release();
     }
 
     UniquePtr(const UniquePtr&) = delete;
@@ -80,7 +133,7 @@ public:
 
     UniquePtr& operator=(std::nullptr_t) {
         data_.GetSecond()(data_.GetFirst());
-        data_.GetFirst() = nullptr;
+        data_.GetFirst() = Pointer();
         return *this;
     }
 
@@ -88,33 +141,60 @@ public:
         data_.GetSecond()(data_.GetFirst());
     }
 
-    T* Release() {
-        T* ptr = data_.GetFirst();
-        data_.GetFirst() = nullptr;
+    Pointer Release() {
+        Pointer ptr = data_.GetFirst();
+        data_.GetFirst() = Pointer();
         return ptr;
     }
 
-    void Reset(T* ptr = nullptr) {
-        T* old_ptr = data_.GetFirst();
+    void Reset(Pointer ptr = Pointer()) {
+        Pointer old_ptr = data_.GetFirst();
         data_.GetFirst() = ptr;
         if (old_ptr) {
             data_.GetSecond()(old_ptr);
         }
     }
 
-    void Swap(UniquePtr& other) {
+    void Swap(UniquePtr& other) noexcept {
         std::swap(other.data_.GetFirst(), data_.GetFirst());
         std::swap(other.data_.GetSecond(), data_.GetSecond());
     }
 
-    T* Get() {
-        return data_.GetFirst();
+    // Replaces the object with `T(args...)`. With Slug the memory of an object of exactly type T
+    // is reused; otherwise this is `Reset(new T(args...))`. If the constructor throws in place,
+    // the pointer becomes empty.
+    template <typename... Args>
+        requires(std::is_same_v<Deleter, Slug<T>> && !std::is_const_v<T>)
+    T& Emplace(Args&&... args) {
+        T* ptr = data_.GetFirst();
+        if (!ptr || !IsReusable(ptr)) {
+            Reset(new T(std::forward<Args>(args)...));
+            return *data_.GetFirst();
+        }
+        ptr->~T();
+        try {
+            new (ptr) T(std::forward<Args>(args)...);
+        } catch (...) {
+            data_.GetFirst() = nullptr;
+            DeallocateSized<T>(ptr);
+            throw;
+        }
+        return *ptr;
     }
 
-    const T* Get() const {
+    Pointer Get() {
         return data_.GetFirst();
     }
 
+    // Plain pointers stay deep-const, handles are returned as is
+    auto Get() const {
+        if constexpr (std::is_same_v<Pointer, T*>) {
+            return static_cast<const T*>(data_.GetFirst());
+        } else {
+            return data_.GetFirst();
+        }
+    }
+
     Deleter& GetDeleter() {
         return data_.GetSecond();
     }
@@ -133,45 +213,68 @@ public:
         return *data_.GetFirst();
     }
 
+    // Also works for fancy pointers such as TaggedPointer
     const T* operator->() const {
-        return data_.GetFirst();
+        return std::to_address(data_.GetFirst());
     }
 
     T* operator->() {
-        return data_.GetFirst();
+        return std::to_address(data_.GetFirst());
     }
 
 private:
-    CompressedPair<T*, Deleter> data_;
+    // The memory came from `new T` and is freed by the global operator delete
+    static bool IsReusable(T* ptr) {
+        if constexpr (!GlobalDeletable<T>) {
+            return false;
+        } else if constexpr (std::is_polymorphic_v<T>) {
+            return typeid(*ptr) == typeid(T);
+        } else {
+            return true;
+        }
+    }
+
+    CompressedPair<Pointer, Deleter> data_;
 };
 
+// Array deleters that cannot release an array without its exact length (the element count decides
+// how the memory is freed) declare `static constexpr bool kNeedsSize = true`. UniquePtr<T[]> then
+// refuses raw pointers of unknown length.
+template <typename Deleter>
+inline constexpr bool kNeedsSize = false;
+
+template <typename Deleter>
+    requires(std::remove_reference_t<Deleter>::kNeedsSize)
+inline constexpr bool kNeedsSize<Deleter> = true;
+
 template <typename T, typename Deleter>
-class UniquePtr<T[], Deleter> {
+class TRIVIAL_ABI UniquePtr<T[], Deleter> {
 public:
-    explicit UniquePtr(T* ptr = nullptr) : data_(ptr, Deleter()) {
+    UniquePtr() noexcept(std::is_nothrow_default_constructible_v<Deleter>)
+        : data_(nullptr, Deleter()) {
     }
 
-    UniquePtr(T* ptr, Deleter deleter) : data_(ptr, std::move(deleter)) {
+    explicit UniquePtr(std::nullptr_t) noexcept(std::is_nothrow_default_constructible_v<Deleter>)
+        : data_(nullptr, Deleter()) {
     }
 
-    UniquePtr(UniquePtr&& other) noexcept {
-        std::swap(data_, other.data_);
+    explicit UniquePtr(T* ptr)
+        requires(!kNeedsSize<Deleter>)
+        : data_(ptr, Deleter()) {
     }
 
-    template <typename U = T, typename OtherDeleter = Deleter>
-        requires(std::is_convertible_v<U*, T*> && std::is_convertible_v<OtherDeleter, Deleter>)
-    UniquePtr(UniquePtr<U, OtherDeleter>&& other) noexcept
-        : data_(other.Release(), std::move(other.GetDeleter())) {
+    UniquePtr(T* ptr, Deleter deleter)
+        requires(!kNeedsSize<Deleter>)
+        : data_(ptr, std::move(deleter)) {
     }
 
-    template <typename U, typename OtherDeleter>
-        requires(std::is_convertible_v<U*, T*> && std::is_convertible_v<OtherDeleter, Deleter>)
-    UniquePtr& operator=(UniquePtr<U, OtherDeleter>&& other) noexcept {
-        if (this != &other) {
-            Reset();
-            data_ = std::move(other.data_);  // Используем перемещение
-        }
-        return *this;
+    // Array of known length; see MakeUniqueAligned and MakeUniqueForOverwrite
+    UniquePtr(T* ptr, size_t size, Deleter deleter) : data_(ptr, std::move(deleter)), size_(size) {
+    }
+
+    UniquePtr(UniquePtr&& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
     }
 
     UniquePtr(const UniquePtr&) = delete;
@@ -181,37 +284,64 @@ public:
         if (this != &other) {
             Reset();
             std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
         }
         return *this;
     }
 
     UniquePtr& operator=(std::nullptr_t) {
-        data_.GetSecond()(data_.GetFirst());
+        Destroy(data_.GetFirst(), size_);
         data_.GetFirst() = nullptr;
+        size_ = 0;
         return *this;
     }
 
     ~UniquePtr() {
-        data_.GetSecond()(data_.GetFirst());
+        Destroy(data_.GetFirst(), size_);
     }
 
     T* Release() {
         T* ptr = data_.GetFirst();
         data_.GetFirst() = nullptr;
+        size_ = 0;
         return ptr;
     }
 
-    void Reset(T* ptr = nullptr) {
+    void Reset() {
+        Reset(nullptr, 0);
+    }
+
+    // The length of `ptr` is unknown, Size() becomes 0
+    void Reset(T* ptr)
+        requires(!kNeedsSize<Deleter>)
+    {
+        Reset(ptr, 0);
+    }
+
+    void Reset(T* ptr, size_t size) {
         T* old_ptr = data_.GetFirst();
+        size_t old_size = std::exchange(size_, size);
         data_.GetFirst() = ptr;
         if (old_ptr) {
-            data_.GetSecond()(old_ptr);
+            Destroy(old_ptr, old_size);
         }
     }
 
-    void Swap(UniquePtr& other) {
+    void Swap(UniquePtr& other) noexcept {
         std::swap(other.data_.GetFirst(), data_.GetFirst());
         std::swap(other.data_.GetSecond(), data_.GetSecond());
+        std::swap(other.size_, size_);
+    }
+
+    // Resizes the array in place when the deleter can do it (see ReallocArrayDelete).
+    // Elements up to min(Size(), new_size) are kept, pointers into the array are invalidated.
+    void Reallocate(size_t new_size)
+        requires requires(Deleter& deleter, T* ptr, size_t size) {
+            { deleter.Reallocate(ptr, size, size) } -> std::same_as<T*>;
+        }
+    {
+        data_.GetFirst() = data_.GetSecond().Reallocate(data_.GetFirst(), size_, new_size);
+        size_ = new_size;
     }
 
     T* Get() {
@@ -256,6 +386,115 @@ public:
         return *(data_.GetFirst() + ind);
     }
 
+    // Number of elements, 0 if the array was passed as a raw pointer
+    size_t Size() const {
+        return size_;
+    }
+
+    T* begin() {
+        return data_.GetFirst();
+    }
+
+    T* end() {
+        return data_.GetFirst() + size_;
+    }
+
+    const T* begin() const {
+        return data_.GetFirst();
+    }
+
+    const T* end() const {
+        return data_.GetFirst() + size_;
+    }
+
+    operator std::span<T>() {
+        return {data_.GetFirst(), size_};
+    }
+
+    operator std::span<const T>() const {
+        return {data_.GetFirst(), size_};
+    }
+
 private:
+    // Deleters that accept the length (e.g. AlignedArrayDelete) get it
+    void Destroy(T* ptr, size_t size) {
+        if constexpr (std::is_invocable_v<Deleter&, T*, size_t>) {
+            data_.GetSecond()(ptr, size);
+        } else {
+            data_.GetSecond()(ptr);
+        }
+    }
+
     CompressedPair<T*, Deleter> data_;
+    size_t size_ = 0;
+};
+
+// Ownership moves to the result only if the cast succeeds, together with the deleter: Slug<U>
+// becomes Slug<T>, any other deleter is moved over. A failed cast returns an empty pointer with
+// a default-constructed deleter.
+template <typename T, typename U, typename Deleter>
+    requires(!std::is_array_v<U>)
+auto DynamicPointerCast(UniquePtr<U, Deleter>&& ptr) {
+    using ResultDeleter = std::conditional_t<std::is_same_v<Deleter, Slug<U>>, Slug<T>, Deleter>;
+    using Result = UniquePtr<T, ResultDeleter>;
+    T* object = CachedDynamicCast<T>(ptr.Get());
+    if (!object) {
+        return Result();
+    }
+    ptr.Release();
+    if constexpr (std::is_same_v<Deleter, Slug<U>>) {
+        return Result(object);
+    } else {
+        return Result(object, std::move(ptr.GetDeleter()));
+    }
+}
+
+// Relocatable as long as the stored pointer and the deleter are (e.g. with the stateless Slug)
+template <typename T, typename Deleter>
+struct IsTriviallyRelocatable<UniquePtr<T, Deleter>>
+    : std::bool_constant<kIsTriviallyRelocatable<typename UniquePointer<T, Deleter>::Type> &&
+                         kIsTriviallyRelocatable<Deleter>> {};
+
+// Releases an array created by MakeUniqueAligned
+template <typename T>
+struct AlignedArrayDelete {
+    static constexpr bool kNeedsSize = true;
+
+    void operator()(T* ptr, size_t size) {
+        if (ptr) {
+            std::destroy_n(ptr, size);
+            ::operator delete[](ptr, size * sizeof(T), align);
+        }
+    }
+
+    std::align_val_t align = std::align_val_t(alignof(T));
 };
+
+// Value-initialized array of `size` elements whose first element is aligned to `align` bytes,
+// a power of two
+template <typename T>
+    requires(std::is_unbounded_array_v<T>)
+UniquePtr<T, AlignedArrayDelete<std::remove_extent_t<T>>> MakeUniqueAligned(size_t size,
+                                                                             size_t align = 64) {
+    using Elem = std::remove_extent_t<T>;
+    assert(std::has_single_bit(align) && "alignment is not a power of two");
+    if (size > SIZE_MAX / sizeof(Elem)) {
+        throw std::bad_array_new_length();
+    }
+    auto alignment = std::align_val_t(std::max(align, alignof(Elem)));
+    auto ptr = static_cast<Elem*>(::operator new[](size * sizeof(Elem), alignment));
+    try {
+        std::uninitialized_value_construct_n(ptr, size);
+    } catch (...) {
+        ::operator delete[](ptr, size * sizeof(Elem), alignment);
+        throw;
+    }
+    return {ptr, size, AlignedArrayDelete<Elem>{alignment}};
+}
+
+// Array of `size` default-initialized elements (trivial types are left uninitialized)
+template <typename T>
+    requires(std::is_unbounded_array_v<T>)
+UniquePtr<T> MakeUniqueForOverwrite(size_t size) {
+    return {new std::remove_extent_t<T>[size], size, Slug<T>()};
+}
@@ -2,12 +2,14 @@
 
 #include "sw_fwd.h"  // Forward declaration
 
+#include <common/trivial_abi.h>
+
 #include <cstddef>  // std::nullptr_t
 #include <utility>
 
 // https://en.cppreference.com/w/cpp/memory/shared_ptr
 template <typename T>
-class SharedPtr {
+class TRIVIAL_ABI SharedPtr {
 public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
@@ -35,7 +37,7 @@ public:
         }
     }
 
-    SharedPtr(SharedPtr&& other) : cb_(other.cb_), observed_pole_(other.observed_pole_) {
+    SharedPtr(SharedPtr&& other) noexcept : cb_(other.cb_), observed_pole_(other.observed_pole_) {
         // if (other.cb_) {
         //     other.cb_->DecrRef();
         // }
@@ -51,7 +53,8 @@ public:
     }
 
     template <typename U>
-    SharedPtr(SharedPtr<U>&& other) : cb_(other.cb_), observed_pole_(other.observed_pole_) {
+    SharedPtr(SharedPtr<U>&& other) noexcept
+        : cb_(other.cb_), observed_pole_(other.observed_pole_) {
         other.cb_ = nullptr;
         other.observed_pole_ = nullptr;
     }
@@ -65,7 +68,9 @@ public:
 
     template <typename Y>
     SharedPtr(const SharedPtr<Y>& other, T* ptr) : cb_(other.cb_), observed_pole_(ptr) {
-        other.cb_->IncrRef();
+        if (cb_) {
+            cb_->IncrRef();
+        }
     }
 
     // Promote `WeakPtr`
@@ -95,7 +100,7 @@ public:
         return *this;
     }
 
-    SharedPtr& operator=(SharedPtr&& other) {
+    SharedPtr& operator=(SharedPtr&& other) noexcept {
         if (this != &other) {
             if (cb_) {
                 cb_->DecrRef();
@@ -127,7 +132,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Modifiers
 
-    void Reset() {
+    void Reset() noexcept {
         if (cb_) {
             cb_->DecrRef();
             // if (cb_->IsRefZero()) {
@@ -170,7 +175,7 @@ public:
         observed_pole_ = ptr;
     }
 
-    void Swap(SharedPtr& other) {
+    void Swap(SharedPtr& other) noexcept {
         std::swap(observed_pole_, other.observed_pole_);
         std::swap(cb_, other.cb_);
     }
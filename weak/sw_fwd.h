@@ -1,5 +1,7 @@
 #pragma once
 
+#include <relocate/relocate.h>
+
 #include <exception>
 #include <memory>
 
@@ -11,6 +13,13 @@ class WeakPtr;
 template <typename T>
 class SharedPtr;
 
+// Both only hold pointers to the control block and the object
+template <typename T>
+struct IsTriviallyRelocatable<SharedPtr<T>> : std::true_type {};
+
+template <typename T>
+struct IsTriviallyRelocatable<WeakPtr<T>> : std::true_type {};
+
 struct ControlBlockBase {
     int ref_count = 1;
     int weak_ref_count = 0;
@@ -7,8 +7,20 @@
 
 #include "allocations_checker.h"
 
+#include <type_traits>
+#include <utility>
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static_assert(std::is_nothrow_move_constructible_v<SharedPtr<int>>);
+static_assert(std::is_nothrow_move_assignable_v<SharedPtr<int>>);
+static_assert(noexcept(std::declval<SharedPtr<int>&>().Swap(std::declval<SharedPtr<int>&>())));
+static_assert(noexcept(std::declval<SharedPtr<int>&>().Reset()));
+static_assert(std::is_nothrow_move_constructible_v<WeakPtr<int>>);
+static_assert(std::is_nothrow_move_assignable_v<WeakPtr<int>>);
+static_assert(noexcept(std::declval<WeakPtr<int>&>().Swap(std::declval<WeakPtr<int>&>())));
+static_assert(noexcept(std::declval<WeakPtr<int>&>().Reset()));
+
 TEST_CASE("Empty weak") {
     WeakPtr<int> a;
     WeakPtr<int> b;
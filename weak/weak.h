@@ -2,9 +2,11 @@
 
 #include "sw_fwd.h"  // Forward declaration
 
+#include <common/trivial_abi.h>
+
 // https://en.cppreference.com/w/cpp/memory/weak_ptr
 template <typename T>
-class WeakPtr {
+class TRIVIAL_ABI WeakPtr {
 public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
@@ -18,7 +20,7 @@ public:
         }
     }
 
-    WeakPtr(WeakPtr&& other) : cb_(other.cb_), observed_pole_(other.observed_pole_) {
+    WeakPtr(WeakPtr&& other) noexcept : cb_(other.cb_), observed_pole_(other.observed_pole_) {
         other.cb_ = nullptr;
         other.observed_pole_ = nullptr;
     }
@@ -46,7 +48,7 @@ public:
         return *this;
     }
 
-    WeakPtr& operator=(WeakPtr&& other) {
+    WeakPtr& operator=(WeakPtr&& other) noexcept {
         if (cb_) {
             cb_->DecrWeakRef();
         }
@@ -69,7 +71,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Modifiers
 
-    void Reset() {
+    void Reset() noexcept {
         if (cb_) {
             cb_->DecrWeakRef();
             cb_ = nullptr;
@@ -77,7 +79,7 @@ public:
         }
     }
 
-    void Swap(WeakPtr& other) {
+    void Swap(WeakPtr& other) noexcept {
         std::swap(cb_, other.cb_);
         std::swap(observed_pole_, other.observed_pole_);
     }